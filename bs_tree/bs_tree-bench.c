@@ -0,0 +1,523 @@
+/*
+ * File:         bs_tree-bench.c
+ * Description:  Benchmarks of the binary search tree module.
+ *
+ *               Build with optimizations, for example:
+ *               gcc -O2 -pthread bs_tree-bench.c bs_tree.c
+ *
+ *               Add -fopenmp to run bs_tree_from_sorted_parallel in parallel.
+ *
+ * Author:       Emil Engvall
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bs_tree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+double now(void);
+void make_input(const char *kind, int n, int *values);
+BSTree *naive_insert(BSTree *tree, int value);
+BSTreePos naive_find(BSTree *tree, int value);
+int naive_height_and_destroy(BSTree *tree, int n);
+void bench_balanced(int n_naive, int n_balanced);
+bool tree_lower_bound(BSTree *tree, int value, int *result);
+void bench_frozen(int n, int queries);
+long resident_kb(void);
+void bench_arena(int n);
+void bench_from_sorted(int n);
+void *run_mixed(void *arg);
+void bench_concurrent(int n, int ops);
+void bench_load(int n, int queries);
+
+
+int main(void)
+{
+    srand(1);
+    // Runs first, so that the resident set sizes are not hidden by freed memory
+    bench_arena(5000000);
+    bench_balanced(20000, 1000000);
+    bench_frozen(10000000, 10000000);
+    bench_from_sorted(20000000);
+    bench_concurrent(1000000, 1000000);
+    bench_load(10000000, 1000000);
+    return 0;
+}
+
+// Returns a monotonic time in seconds.
+double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Fills values with n distinct values in the order given by kind.
+void make_input(const char *kind, int n, int *values)
+{
+    for (int i = 0; i < n; i++) {
+        if (kind[0] == 's') {
+            // Sorted
+            values[i] = i;
+        } else if (kind[0] == 'z') {
+            // Zig-zag from both ends towards the middle
+            values[i] = i % 2 == 0 ? i / 2 : n - 1 - i / 2;
+        } else {
+            values[i] = i;
+        }
+    }
+    if (kind[0] == 'r') {
+        // Random order
+        for (int i = n - 1; i > 0; i--) {
+            int j = rand() % (i + 1);
+            int tmp = values[i];
+            values[i] = values[j];
+            values[j] = tmp;
+        }
+    }
+}
+
+// Inserts a value without rebalancing, as callers had to do before bs_tree_insert.
+BSTree *naive_insert(BSTree *tree, int value)
+{
+    if (tree == NULL) {
+        return bs_tree_make(value);
+    }
+    BSTreePos pos = tree;
+    for (;;) {
+        if (value < pos->value) {
+            if (pos->left_child == NULL) {
+                bs_tree_insert_left(value, pos);
+                return tree;
+            }
+            pos = pos->left_child;
+        } else if (value > pos->value) {
+            if (pos->right_child == NULL) {
+                bs_tree_insert_right(value, pos);
+                return tree;
+            }
+            pos = pos->right_child;
+        } else {
+            return tree;
+        }
+    }
+}
+
+// Searches an unbalanced tree.
+BSTreePos naive_find(BSTree *tree, int value)
+{
+    BSTreePos pos = tree;
+    while (pos != NULL && pos->value != value) {
+        pos = value < pos->value ? pos->left_child : pos->right_child;
+    }
+    return pos;
+}
+
+// Computes the height of an unbalanced tree and frees it, without recursion.
+int naive_height_and_destroy(BSTree *tree, int n)
+{
+    BSTreePos *stack = malloc((n + 1) * sizeof(BSTreePos));
+    int *depth = malloc((n + 1) * sizeof(int));
+    int top = 0;
+    int h = 0;
+
+    if (tree != NULL) {
+        stack[top] = tree;
+        depth[top++] = 1;
+    }
+    while (top > 0) {
+        top--;
+        BSTreePos pos = stack[top];
+        int d = depth[top];
+        h = d > h ? d : h;
+        if (pos->left_child != NULL) {
+            stack[top] = pos->left_child;
+            depth[top++] = d + 1;
+        }
+        if (pos->right_child != NULL) {
+            stack[top] = pos->right_child;
+            depth[top++] = d + 1;
+        }
+        free(pos);
+    }
+
+    free(stack);
+    free(depth);
+    return h;
+}
+
+// Compares unbalanced and AVL-balanced insertion on sorted, zig-zag and random input.
+void bench_balanced(int n_naive, int n_balanced)
+{
+    const char *kinds[] = {"sorted", "zigzag", "random"};
+
+    printf("\nbs_tree_insert compared with unbalanced insertion\n");
+    printf("%-8s %-10s %9s %14s %14s %8s\n", "input", "tree", "n", "insert (ns)", "find (ns)", "height");
+
+    for (int k = 0; k < 3; k++) {
+        for (int balanced = 0; balanced < 2; balanced++) {
+            int n = balanced ? n_balanced : n_naive;
+            int *values = malloc(n * sizeof(int));
+            make_input(kinds[k], n, values);
+
+            BSTree *tree = NULL;
+            double start = now();
+            for (int i = 0; i < n; i++) {
+                tree = balanced ? bs_tree_insert(tree, values[i]) : naive_insert(tree, values[i]);
+            }
+            double insert = (now() - start) / n;
+
+            long found = 0;
+            start = now();
+            for (int i = 0; i < n; i++) {
+                found += (balanced ? bs_tree_find(tree, values[i]) : naive_find(tree, values[i])) != NULL;
+            }
+            double find = (now() - start) / n;
+
+            int h;
+            if (balanced) {
+                h = bs_tree_height(tree);
+                bs_tree_destroy(tree);
+            } else {
+                h = naive_height_and_destroy(tree, n);
+            }
+            printf("%-8s %-10s %9d %14.1f %14.1f %8d\n", kinds[k], balanced ? "avl" : "unbalanced",
+                   n, insert * 1e9, find * 1e9, h);
+            if (found != n) {
+                printf("error: %ld of %d values found\n", found, n);
+            }
+            free(values);
+        }
+    }
+}
+
+// Finds the smallest value >= value by following child pointers.
+bool tree_lower_bound(BSTree *tree, int value, int *result)
+{
+    BSTreePos pos = tree;
+    bool found = false;
+    while (pos != NULL) {
+        if (pos->value >= value) {
+            *result = pos->value;
+            found = true;
+            pos = pos->left_child;
+        } else {
+            pos = pos->right_child;
+        }
+    }
+    return found;
+}
+
+// Compares lower-bound searches in a pointer tree and in its frozen copy.
+void bench_frozen(int n, int queries)
+{
+    BSTree *tree = NULL;
+    for (int i = 0; i < n; i++) {
+        tree = bs_tree_insert(tree, 2 * i);
+    }
+
+    double start = now();
+    BSTreeFrozen *frozen = bs_tree_freeze(tree);
+    double freeze = now() - start;
+
+    int *query = malloc(queries * sizeof(int));
+    for (int i = 0; i < queries; i++) {
+        query[i] = (int)(((long long)rand() * RAND_MAX + rand()) % (2LL * n));
+    }
+
+    long long checksum[2] = {0, 0};
+    double elapsed[2];
+    for (int k = 0; k < 2; k++) {
+        start = now();
+        for (int i = 0; i < queries; i++) {
+            int result = 0;
+            if (k == 0) {
+                tree_lower_bound(tree, query[i], &result);
+            } else {
+                bs_tree_frozen_lower_bound(frozen, query[i], &result);
+            }
+            checksum[k] += result;
+        }
+        elapsed[k] = (now() - start) / queries;
+    }
+
+    printf("\nLower bound of %d random values among %d keys\n", queries, n);
+    printf("%-12s %14s\n", "layout", "search (ns)");
+    printf("%-12s %14.1f\n", "pointers", elapsed[0] * 1e9);
+    printf("%-12s %14.1f\n", "eytzinger", elapsed[1] * 1e9);
+    printf("(bs_tree_freeze took %.3f s", freeze);
+    printf(checksum[0] == checksum[1] ? ", results agree)\n" : ", RESULTS DIFFER)\n");
+
+    free(query);
+    bs_tree_frozen_destroy(frozen);
+    bs_tree_destroy(tree);
+}
+
+// Returns the resident set size of the process in kilobytes, or -1 if unknown.
+long resident_kb(void)
+{
+    long pages = -1;
+    long resident = -1;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f != NULL) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+            resident = -1;
+        }
+        fclose(f);
+    }
+    return resident < 0 ? -1 : resident * 4;
+}
+
+// Compares building and tearing down a tree with malloc and with an arena.
+void bench_arena(int n)
+{
+    int *values = malloc(n * sizeof(int));
+    make_input("random", n, values);
+
+    printf("Building and destroying a tree of %d random values\n", n);
+    printf("%-8s %14s %14s %12s\n", "nodes", "insert (ns)", "destroy (ms)", "rss (MB)");
+
+    for (int use_arena = 1; use_arena >= 0; use_arena--) {
+        long base = resident_kb();
+        BSTreeArena *arena = use_arena ? bs_tree_arena_create(0) : NULL;
+        BSTree *tree = NULL;
+
+        double start = now();
+        for (int i = 0; i < n; i++) {
+            tree = use_arena ? bs_tree_arena_insert(arena, tree, values[i]) : bs_tree_insert(tree, values[i]);
+        }
+        double insert = (now() - start) / n;
+        long rss = resident_kb() - base;
+
+        start = now();
+        if (use_arena) {
+            bs_tree_arena_destroy(arena);
+        } else {
+            bs_tree_destroy(tree);
+        }
+        double destroy = now() - start;
+
+        printf("%-8s %14.1f %14.2f %12.1f\n", use_arena ? "arena" : "malloc",
+               insert * 1e9, destroy * 1e3, rss / 1024.0);
+    }
+
+    free(values);
+}
+
+// Compares building a tree of sorted values by insertion and by bulk-loading.
+void bench_from_sorted(int n)
+{
+    int *values = malloc(n * sizeof(int));
+    make_input("sorted", n, values);
+
+    printf("\nBuilding a tree of %d sorted values\n", n);
+    printf("%-22s %10s %8s\n", "method", "time (s)", "height");
+
+    for (int k = 0; k < 3; k++) {
+        BSTreeArena *arena = bs_tree_arena_create(0);
+        BSTree *tree = NULL;
+        double start = now();
+        if (k == 0) {
+            for (int i = 0; i < n; i++) {
+                tree = bs_tree_arena_insert(arena, tree, values[i]);
+            }
+        } else if (k == 1) {
+            tree = bs_tree_from_sorted(arena, values, n);
+        } else {
+            tree = bs_tree_from_sorted_parallel(arena, values, n);
+        }
+        double elapsed = now() - start;
+
+        const char *names[] = {"bs_tree_arena_insert", "from_sorted", "from_sorted_parallel"};
+        printf("%-22s %10.3f %8d\n", names[k], elapsed, bs_tree_height(tree));
+        bs_tree_arena_destroy(arena);
+    }
+
+    free(values);
+}
+
+// Work of one thread in bench_concurrent.
+struct mixed_work {
+    BSTreeConcurrent *concurrent;  // The tree, or NULL to use locked
+    BSTree **locked;               // Tree protected by lock
+    pthread_rwlock_t *lock;
+    int n;                         // Values are drawn from [0, 2n)
+    int ops;                       // Number of operations
+    int write_permille;            // Share of inserts and deletes
+    unsigned seed;
+    long found;
+};
+
+// Runs a mix of lookups, inserts and deletes on one of the trees.
+void *run_mixed(void *arg)
+{
+    struct mixed_work *w = arg;
+    unsigned x = w->seed;
+    int slot = w->concurrent != NULL ? bs_tree_concurrent_reader_register(w->concurrent) : -1;
+
+    for (int i = 0; i < w->ops; i++) {
+        // xorshift, since rand is not thread-safe
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        int value = (int)(x % (2u * w->n));
+        bool write = (int)((x >> 8) % 1000) < w->write_permille;
+
+        if (w->concurrent != NULL) {
+            if (!write) {
+                w->found += bs_tree_concurrent_contains(w->concurrent, slot, value);
+            } else if (value % 2 == 0) {
+                bs_tree_concurrent_insert(w->concurrent, value);
+            } else {
+                bs_tree_concurrent_delete(w->concurrent, value - 1);
+            }
+        } else if (!write) {
+            pthread_rwlock_rdlock(w->lock);
+            w->found += bs_tree_find(*w->locked, value) != NULL;
+            pthread_rwlock_unlock(w->lock);
+        } else {
+            pthread_rwlock_wrlock(w->lock);
+            *w->locked = value % 2 == 0 ? bs_tree_insert(*w->locked, value) : bs_tree_delete(*w->locked, value - 1);
+            pthread_rwlock_unlock(w->lock);
+        }
+    }
+
+    if (slot >= 0) {
+        bs_tree_concurrent_reader_unregister(w->concurrent, slot);
+    }
+    return NULL;
+}
+
+// Compares the concurrent tree with a tree behind a readers-writer lock, for
+// read-mostly workloads on 1 to 64 threads. The total number of operations
+// is split between the threads.
+void bench_concurrent(int n, int ops)
+{
+    int thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+    int write_permilles[] = {0, 10, 100};
+
+    printf("\nLookups mixed with inserts and deletes among %d values, %d operations\n", n, ops);
+    printf("%-8s %8s %8s %14s\n", "tree", "writes", "threads", "Mops/s");
+
+    for (int w = 0; w < 3; w++) {
+        for (int use_concurrent = 0; use_concurrent < 2; use_concurrent++) {
+            for (int t = 0; t < 7; t++) {
+                int threads = thread_counts[t];
+                BSTreeConcurrent *concurrent = use_concurrent ? bs_tree_concurrent_create(threads) : NULL;
+                BSTree *locked = NULL;
+                pthread_rwlock_t lock;
+                pthread_rwlock_init(&lock, NULL);
+                for (int i = 0; i < n; i++) {
+                    if (use_concurrent) {
+                        bs_tree_concurrent_insert(concurrent, 2 * i);
+                    } else {
+                        locked = bs_tree_insert(locked, 2 * i);
+                    }
+                }
+
+                pthread_t tid[64];
+                struct mixed_work work[64];
+                double start = now();
+                for (int i = 0; i < threads; i++) {
+                    work[i] = (struct mixed_work){concurrent, &locked, &lock, n, ops / threads,
+                                                  write_permilles[w], 2654435761u * (i + 1), 0};
+                    pthread_create(&tid[i], NULL, run_mixed, &work[i]);
+                }
+                for (int i = 0; i < threads; i++) {
+                    pthread_join(tid[i], NULL);
+                }
+                double elapsed = now() - start;
+
+                printf("%-8s %7.1f%% %8d %14.2f\n", use_concurrent ? "epoch" : "rwlock",
+                       write_permilles[w] / 10.0, threads, ops / elapsed * 1e-6);
+
+                if (use_concurrent) {
+                    bs_tree_concurrent_destroy(concurrent);
+                } else {
+                    bs_tree_destroy(locked);
+                }
+                pthread_rwlock_destroy(&lock);
+            }
+        }
+    }
+}
+
+// Measures saving a tree and loading it back, either mapped and searched in
+// place or rebuilt into nodes.
+void bench_load(int n, int queries)
+{
+    const char *path = "bs_tree-bench.tmp";
+    int *values = malloc(n * sizeof(int));
+    make_input("sorted", n, values);
+    BSTreeArena *arena = bs_tree_arena_create(0);
+    BSTree *tree = bs_tree_from_sorted(arena, values, n);
+
+    double start = now();
+    bs_tree_save(tree, path);
+    double save = now() - start;
+    bs_tree_arena_destroy(arena);
+
+    printf("\nSaving %d values took %.3f s\n", n, save);
+    printf("%-16s %10s %16s\n", "load", "time (s)", "first queries (s)");
+
+    for (int k = 0; k < 3; k++) {
+        start = now();
+        BSTreeFrozen *frozen = bs_tree_load(path, k == 1);
+        arena = NULL;
+        tree = NULL;
+        if (k == 2) {
+            // Rebuild nodes from the mapped keys, sorted by an in-order walk
+            int count = 0;
+            int *stack = malloc(64 * sizeof(int));
+            int top = 0;
+            int i = 1;
+            while (i <= frozen->n || top > 0) {
+                if (i <= frozen->n) {
+                    stack[top++] = i;
+                    i = 2 * i;
+                } else {
+                    i = stack[--top];
+                    values[count++] = frozen->keys[i];
+                    i = 2 * i + 1;
+                }
+            }
+            free(stack);
+            arena = bs_tree_arena_create(0);
+            tree = bs_tree_from_sorted(arena, values, count);
+        }
+        double load = now() - start;
+
+        long long checksum = 0;
+        start = now();
+        for (int q = 0; q < queries; q++) {
+            int value = (int)((long long)q * 7919 % n);
+            int result = 0;
+            if (tree != NULL) {
+                tree_lower_bound(tree, value, &result);
+            } else {
+                bs_tree_frozen_lower_bound(frozen, value, &result);
+            }
+            checksum += result;
+        }
+        double query = now() - start;
+
+        const char *names[] = {"mapped", "mapped+verify", "rebuilt nodes"};
+        printf("%-16s %10.3f %16.3f\n", names[k], load, query);
+        if (checksum < 0) {
+            printf("error: negative checksum\n");
+        }
+
+        if (arena != NULL) {
+            bs_tree_arena_destroy(arena);
+        }
+        bs_tree_frozen_destroy(frozen);
+    }
+
+    remove(path);
+    free(values);
+}
@@ -9,6 +9,15 @@ void print_array(int n, int a[]);
 void swap(int *a, int *b);
 void insert_value(int value, BSTreePos first_pos);
 BSTreePos search_value(int value, BSTreePos first_pos);
+void print_test_result(bool condition, const char *test_name);
+void test_keyed_operations(void);
+void test_freeze(void);
+void test_arena(void);
+void test_order_statistics(void);
+void test_from_sorted(void);
+void test_versions(void);
+void test_concurrent(void);
+void test_save_load(void);
 
 
 int main(void)
@@ -64,6 +73,15 @@ int main(void)
     // Destroy the binary search tree.
     bs_tree_destroy(tree);
 
+    test_keyed_operations();
+    test_freeze();
+    test_arena();
+    test_order_statistics();
+    test_from_sorted();
+    test_versions();
+    test_concurrent();
+    test_save_load();
+
     return 0;
 }
 
@@ -131,4 +149,308 @@ BSTreePos search_value(int value, BSTreePos pos)
         }
     }
     return NULL;
-}
\ No newline at end of file
+}
+
+// Print the result of a test.
+void print_test_result(bool condition, const char *test_name)
+{
+    printf("%s: %s\n", condition ? "PASS" : "FAIL", test_name);
+}
+
+
+// Insert sorted values, delete every other one and check that the tree
+// stays ordered and balanced.
+void test_keyed_operations(void)
+{
+    int n = 1000;
+    BSTree *tree = NULL;
+    for (int i = 0; i < n; i++) {
+        tree = bs_tree_insert(tree, i);
+    }
+    tree = bs_tree_insert(tree, 500);
+
+    bool condition = bs_tree_height(tree) <= 11;
+    for (int i = 0; i < n; i++) {
+        condition = condition && bs_tree_find(tree, i) != NULL;
+    }
+    condition = condition && bs_tree_find(tree, n) == NULL && bs_tree_find(tree, -1) == NULL;
+    print_test_result(condition, "bs_tree_insert and bs_tree_find");
+
+    for (int i = 0; i < n; i += 2) {
+        tree = bs_tree_delete(tree, i);
+    }
+    tree = bs_tree_delete(tree, n + 10);
+
+    condition = bs_tree_height(tree) <= 10;
+    for (int i = 0; i < n; i++) {
+        condition = condition && (bs_tree_find(tree, i) != NULL) == (i % 2 == 1);
+    }
+    print_test_result(condition, "bs_tree_delete");
+
+    for (int i = 1; i < n; i += 2) {
+        tree = bs_tree_delete(tree, i);
+    }
+    print_test_result(tree == NULL, "bs_tree_delete (all values)");
+}
+
+
+// Freeze a tree and compare its lower bounds with a linear search.
+void test_freeze(void)
+{
+    BSTree *tree = NULL;
+    for (int i = 0; i < 300; i++) {
+        tree = bs_tree_insert(tree, (i * 37) % 300 * 3);
+    }
+
+    BSTreeFrozen *frozen = bs_tree_freeze(tree);
+    bool condition = frozen != NULL && frozen->n == 300;
+    for (int value = -5; condition && value < 905; value++) {
+        int expected = (value + 2) / 3 * 3;
+        if (value < 0) {
+            expected = 0;
+        }
+        int found;
+        bool exists = bs_tree_frozen_lower_bound(frozen, value, &found);
+        condition = expected <= 897 ? exists && found == expected : !exists;
+    }
+
+    // The tree must be intact after the traversal
+    condition = condition && bs_tree_find(tree, 897) != NULL && bs_tree_height(tree) <= 10;
+    print_test_result(condition, "bs_tree_freeze and bs_tree_frozen_lower_bound");
+
+    bs_tree_frozen_destroy(frozen);
+    bs_tree_destroy(tree);
+}
+
+
+// Destroy a degenerate tree deep enough to overflow a recursive destroy,
+// then build, shrink and regrow a tree in an arena.
+void test_arena(void)
+{
+    int n = 1000000;
+    BSTree *chain = bs_tree_make(0);
+    BSTreePos pos = chain;
+    for (int i = 1; i < n && pos != NULL; i++) {
+        pos = bs_tree_insert_right(i, pos);
+    }
+    BSTreePos middle = bs_tree_find(chain, n / 2);
+    bool condition = pos != NULL && bs_tree_find(chain, n - 1) == pos
+        && middle != NULL && bs_tree_inspect_label(middle) == n / 2
+        && bs_tree_find(chain, n) == NULL;
+    // Reaching the result at all shows that destroy did not recurse
+    bs_tree_destroy(chain);
+    print_test_result(condition, "bs_tree_find and bs_tree_destroy (degenerate tree)");
+
+    BSTreeArena *arena = bs_tree_arena_create(64);
+    BSTree *tree = bs_tree_arena_make(arena, 0);
+    for (int i = 1; i < 1000; i++) {
+        tree = bs_tree_arena_insert(arena, tree, i);
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        tree = bs_tree_arena_delete(arena, tree, i);
+    }
+    struct bs_tree_slab *newest = arena->slabs;
+    for (int i = 0; i < 1000; i += 2) {
+        tree = bs_tree_arena_insert(arena, tree, i);
+    }
+
+    // The deleted nodes are reused, so no new slab is needed
+    condition = arena->slabs == newest && bs_tree_height(tree) <= 11;
+    for (int i = 0; i < 1000; i++) {
+        condition = condition && bs_tree_find(tree, i) != NULL;
+    }
+    print_test_result(condition, "bs_tree_arena_insert and bs_tree_arena_delete");
+
+    bs_tree_arena_destroy(arena);
+}
+
+
+// Check rank, select, range counts and range iteration on the multiples of
+// three, before and after deleting some of them.
+void test_order_statistics(void)
+{
+    BSTree *tree = NULL;
+    for (int i = 0; i < 500; i++) {
+        tree = bs_tree_insert(tree, (i * 7) % 500 * 3);
+    }
+    for (int i = 0; i < 500; i += 5) {
+        tree = bs_tree_delete(tree, i * 3);
+    }
+
+    // The remaining values are 3i for the 400 values of i not divisible by 5
+    bool condition = bs_tree_size(tree) == 400 && bs_tree_select(tree, 400) == NULL;
+    for (int i = 0, k = 0; condition && i < 500; i++) {
+        if (i % 5 != 0) {
+            BSTreePos pos = bs_tree_select(tree, k);
+            condition = pos != NULL && pos->value == 3 * i
+                && bs_tree_rank(tree, 3 * i) == k && bs_tree_rank(tree, 3 * i + 1) == k + 1;
+            k++;
+        }
+    }
+    print_test_result(condition, "bs_tree_rank and bs_tree_select");
+
+    condition = bs_tree_count_range(tree, 0, 1500) == 400
+        && bs_tree_count_range(tree, 3, 15) == 4
+        && bs_tree_count_range(tree, 4, 5) == 0
+        && bs_tree_count_range(tree, 10, 2) == 0;
+    print_test_result(condition, "bs_tree_count_range");
+
+    BSTreeIter iter;
+    int count = 0;
+    int previous = 100;
+    bs_tree_range_begin(&iter, tree, 101, 1000);
+    for (BSTreePos pos = bs_tree_range_next(&iter); pos != NULL; pos = bs_tree_range_next(&iter)) {
+        condition = condition && pos->value > previous && pos->value <= 1000;
+        previous = pos->value;
+        count++;
+    }
+    condition = condition && count == bs_tree_count_range(tree, 101, 1000);
+    print_test_result(condition, "bs_tree_range_begin and bs_tree_range_next");
+
+    bs_tree_destroy(tree);
+}
+
+
+// Bulk-load sorted values and check the shape, the order statistics and
+// that the tree can still be changed.
+void test_from_sorted(void)
+{
+    int n = 100000;
+    int *vals = malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        vals[i] = 2 * i;
+    }
+
+    BSTreeArena *arena = bs_tree_arena_create(0);
+    BSTree *trees[2] = {
+        bs_tree_from_sorted(arena, vals, n),
+        bs_tree_from_sorted_parallel(arena, vals, n)
+    };
+    bool condition = true;
+    for (int t = 0; t < 2; t++) {
+        condition = condition && bs_tree_size(trees[t]) == n && bs_tree_height(trees[t]) == 17;
+        for (int k = 0; condition && k < n; k += 97) {
+            BSTreePos pos = bs_tree_select(trees[t], k);
+            condition = pos != NULL && pos->value == 2 * k && bs_tree_find(trees[t], 2 * k + 1) == NULL;
+        }
+    }
+    print_test_result(condition, "bs_tree_from_sorted and bs_tree_from_sorted_parallel");
+
+    BSTree *tree = bs_tree_arena_delete(arena, trees[0], 0);
+    tree = bs_tree_arena_insert(arena, tree, 1);
+    condition = bs_tree_size(tree) == n && bs_tree_rank(tree, 2) == 1
+        && bs_tree_from_sorted(arena, (int[]){2, 1}, 2) == NULL;
+    print_test_result(condition, "bs_tree_from_sorted (changes and unsorted input)");
+
+    bs_tree_arena_destroy(arena);
+    free(vals);
+}
+
+
+// Keep every version while inserting and deleting, and check that each of
+// them still holds exactly the values it was created with.
+void test_versions(void)
+{
+    int n = 200;
+    BSTreeVersion *versions[2 * n + 1];
+    versions[0] = NULL;
+    for (int i = 0; i < n; i++) {
+        versions[i + 1] = bs_tree_version_insert(versions[i], (i * 37) % n);
+    }
+    for (int i = 0; i < n; i++) {
+        versions[n + i + 1] = bs_tree_version_delete(versions[n + i], (i * 53) % n);
+    }
+
+    bool condition = true;
+    for (int v = 0; v <= 2 * n; v++) {
+        for (int value = 0; value < n; value++) {
+            bool inserted = false;
+            for (int i = 0; i < v && i < n; i++) {
+                inserted = inserted || (i * 37) % n == value;
+            }
+            for (int i = 0; i < v - n; i++) {
+                inserted = inserted && (i * 53) % n != value;
+            }
+            condition = condition && bs_tree_version_contains(versions[v], value) == inserted;
+        }
+    }
+    int smallest;
+    condition = condition && bs_tree_version_size(versions[n]) == n
+        && bs_tree_version_select(versions[n], 0, &smallest) && smallest == 0
+        && versions[2 * n] == NULL;
+    print_test_result(condition, "bs_tree_version_insert and bs_tree_version_delete");
+
+    // A snapshot outlives the versions it was taken from
+    BSTreeVersion *snapshot = bs_tree_version_snapshot(versions[n]);
+    for (int v = 0; v <= 2 * n; v++) {
+        bs_tree_version_release(versions[v]);
+    }
+    condition = bs_tree_version_size(snapshot) == n && bs_tree_version_contains(snapshot, n - 1);
+    print_test_result(condition, "bs_tree_version_snapshot");
+    bs_tree_version_release(snapshot);
+}
+
+
+// A reader keeps seeing its version while a writer changes the tree.
+void test_concurrent(void)
+{
+    BSTreeConcurrent *tree = bs_tree_concurrent_create(2);
+    for (int i = 0; i < 100; i++) {
+        bs_tree_concurrent_insert(tree, i);
+    }
+    int reader = bs_tree_concurrent_reader_register(tree);
+    const BSTreeVersion *before = bs_tree_concurrent_read_begin(tree, reader);
+
+    bool condition = bs_tree_concurrent_delete(tree, 50) && bs_tree_concurrent_insert(tree, 200)
+        && bs_tree_concurrent_insert(tree, 200) && bs_tree_concurrent_version(tree) == 102;
+
+    // The reader still sees the old version until it stops reading
+    condition = condition && bs_tree_version_contains(before, 50) && !bs_tree_version_contains(before, 200)
+        && bs_tree_version_size(before) == 100;
+    bs_tree_concurrent_read_end(tree, reader);
+
+    condition = condition && !bs_tree_concurrent_contains(tree, reader, 50)
+        && bs_tree_concurrent_contains(tree, reader, 200);
+    print_test_result(condition, "bs_tree_concurrent reads and writes");
+
+    bs_tree_concurrent_reader_unregister(tree, reader);
+    bs_tree_concurrent_destroy(tree);
+}
+
+
+// Save a tree, load it back and search the mapped file, then check that a
+// corrupted file is rejected.
+void test_save_load(void)
+{
+    const char *path = "bs_tree-test.tmp";
+    BSTree *tree = NULL;
+    for (int i = 0; i < 1000; i++) {
+        tree = bs_tree_insert(tree, (i * 7) % 1000 * 2);
+    }
+
+    bool condition = bs_tree_save(tree, path);
+    BSTreeFrozen *loaded = bs_tree_load(path, true);
+    condition = condition && loaded != NULL && loaded->n == 1000 && loaded->mapping != NULL;
+    for (int value = 0; condition && value < 1999; value++) {
+        int found;
+        condition = bs_tree_frozen_lower_bound(loaded, value, &found) && found == (value + 1) / 2 * 2;
+    }
+    condition = condition && !bs_tree_frozen_lower_bound(loaded, 1999, NULL);
+    print_test_result(condition, "bs_tree_save and bs_tree_load");
+    if (loaded != NULL) {
+        bs_tree_frozen_destroy(loaded);
+    }
+
+    // Flip one byte of the keys
+    FILE *fp = fopen(path, "r+b");
+    fseek(fp, -4, SEEK_END);
+    int c = fgetc(fp);
+    fseek(fp, -4, SEEK_END);
+    fputc(c ^ 0xff, fp);
+    fclose(fp);
+    loaded = bs_tree_load(path, true);
+    print_test_result(loaded == NULL, "bs_tree_load (corrupt file)");
+
+    remove(path);
+    bs_tree_destroy(tree);
+}
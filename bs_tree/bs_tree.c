@@ -11,140 +11,1545 @@
  * 
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "bs_tree.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * Node of a persistent tree. A node is never changed once another node or
+ * version may refer to it; refs counts those references.
+ */
+struct bs_tree_version {
+    int value;                              /* The value of the node */
+    int height;                             /* Height of the subtree */
+    int size;                               /* Number of nodes in the subtree */
+    atomic_int refs;                        /* Number of parents and versions referring to the node */
+    struct bs_tree_version *left_child;     /* Pointer to the left child */
+    struct bs_tree_version *right_child;    /* Pointer to the right child */
+};
+
+typedef struct bs_tree_version *VersionPos;
+
+/* Identification of the files written by bs_tree_save */
+#define BS_TREE_FILE_MAGIC "BSTREEEY"
+#define BS_TREE_FILE_VERSION 1
+#define BS_TREE_FILE_BYTE_ORDER 0x01020304u
+
+/**
+ * Header of the files written by bs_tree_save, followed by the n + 1 keys of
+ * a frozen tree. The header fills a cache line, so that the keys start on
+ * one when the file is mapped.
+ */
+struct bs_tree_file_header {
+    char magic[8];          /* BS_TREE_FILE_MAGIC without terminator */
+    uint32_t version;       /* BS_TREE_FILE_VERSION */
+    uint32_t byte_order;    /* BS_TREE_FILE_BYTE_ORDER as written by the saving machine */
+    int32_t n;              /* Number of values */
+    uint32_t reserved;      /* Zero */
+    uint64_t checksum;      /* FNV-1a hash of the keys */
+    char padding[32];       /* Zero */
+};
+
+/**
+ * Epoch announced by a registered reader that is not reading.
+ */
+#define READER_IDLE LLONG_MAX
+
+/**
+ * A replaced version of a concurrent tree that readers may still hold.
+ */
+struct bs_tree_retired {
+    BSTreeVersion *version;             /* The replaced version */
+    long long retired;                  /* Epoch in which the version was replaced */
+    struct bs_tree_retired *next;       /* Next replaced version */
+};
+
+struct bs_tree_concurrent {
+    _Atomic(BSTreeVersion *) current;   /* Version seen by new readers */
+    atomic_llong epoch;                 /* Number of the current version */
+    int max_readers;                    /* Number of reader slots */
+    atomic_int *registered;             /* Whether a slot is taken */
+    atomic_llong *announced;            /* Epoch each reader started in, or READER_IDLE */
+    atomic_flag writer;                 /* Lock serializing the writers */
+    struct bs_tree_retired *retired;    /* Replaced versions not yet released */
+};
 
 /* ---------------------- Internal functions ---------------------- */
 
 /**
- * Recursively frees a BST node and its children.
- *
- * This internal function is called for deallocating a node and its
- * child nodes in the tree, used primarily by bs_tree_destroy.
+ * Frees a BST node and all its descendants without recursion.
  *
- * The BST node to be destroyed.
+ * Whenever the current node has a left child, the child is rotated up in
+ * its place. A node without a left child can be freed, continuing with its
+ * right child. Every rotation moves one node to the right spine for good,
+ * so the whole tree is freed in O(n) time and constant memory.
  */
 void destroy_node(BSTree *node) 
 {
+    while (node != NULL) {
+        if (node->left_child != NULL) {
+            BSTreePos left = node->left_child;
+            node->left_child = left->right_child;
+            left->right_child = node;
+            node = left;
+        } else {
+            BSTreePos right = node->right_child;
+            free(node);
+            node = right;
+        }
+    }
+}
+
+/**
+ * Allocates a leaf node, from an arena if one is given.
+ */
+static BSTreePos alloc_node(BSTreeArena *arena, int value)
+{
+    BSTreePos node;
+
+    if (arena == NULL) {
+        node = malloc(sizeof(struct node));
+    } else if (arena->free_nodes != NULL) {
+        node = arena->free_nodes;
+        arena->free_nodes = node->right_child;
+    } else {
+        if (arena->slabs == NULL || arena->used == arena->slabs->capacity) {
+            struct bs_tree_slab *slab = malloc(sizeof(struct bs_tree_slab)
+                                               + (size_t)arena->slab_capacity * sizeof(struct node));
+            if (slab == NULL) {
+                return NULL;
+            }
+            slab->next = arena->slabs;
+            slab->capacity = arena->slab_capacity;
+            arena->slabs = slab;
+            arena->used = 0;
+        }
+        node = &arena->slabs->nodes[arena->used++];
+    }
+
     if (node != NULL) {
-        destroy_node(node->left_child);
-        destroy_node(node->right_child);
+        node->value = value;
+        node->height = 1;
+        node->size = 1;
+        node->left_child = NULL;
+        node->right_child = NULL;
+    }
+    return node;
+}
+
+/**
+ * Releases a node, to the free list of an arena if one is given.
+ */
+static void free_node(BSTreeArena *arena, BSTreePos node)
+{
+    if (arena == NULL) {
         free(node);
+    } else {
+        node->right_child = arena->free_nodes;
+        arena->free_nodes = node;
     }
 }
 
-/* ---------------------- External functions ---------------------- */
+/**
+ * Returns the height of a subtree, 0 for an empty one.
+ */
+static int height(BSTreePos pos)
+{
+    return pos != NULL ? pos->height : 0;
+}
 
-BSTree *bs_tree_make(int value) 
+/**
+ * Returns the number of nodes in a subtree, 0 for an empty one.
+ */
+static int size(BSTreePos pos)
 {
-    BSTree *new_tree = (BSTree *)malloc(sizeof(BSTree));
-    if (new_tree == NULL) {
-        perror("Error in bs_tree_make: Memory allocation failed");
-        return NULL;
+    return pos != NULL ? pos->size : 0;
+}
+
+/**
+ * Recomputes the height and size of a node from those of its children.
+ */
+static void update_node(BSTreePos pos)
+{
+    int left = height(pos->left_child);
+    int right = height(pos->right_child);
+    pos->height = (left > right ? left : right) + 1;
+    pos->size = size(pos->left_child) + size(pos->right_child) + 1;
+}
+
+/**
+ * Rotates a subtree to the right and returns its new root.
+ */
+static BSTreePos rotate_right(BSTreePos pos)
+{
+    BSTreePos left = pos->left_child;
+    pos->left_child = left->right_child;
+    left->right_child = pos;
+    update_node(pos);
+    update_node(left);
+    return left;
+}
+
+/**
+ * Rotates a subtree to the left and returns its new root.
+ */
+static BSTreePos rotate_left(BSTreePos pos)
+{
+    BSTreePos right = pos->right_child;
+    pos->right_child = right->left_child;
+    right->left_child = pos;
+    update_node(pos);
+    update_node(right);
+    return right;
+}
+
+/**
+ * Restores the AVL balance of a subtree whose children are balanced and
+ * differ in height by at most two, and returns its new root.
+ */
+static BSTreePos rebalance(BSTreePos pos)
+{
+    update_node(pos);
+    int balance = height(pos->left_child) - height(pos->right_child);
+
+    if (balance > 1) {
+        if (height(pos->left_child->left_child) < height(pos->left_child->right_child)) {
+            pos->left_child = rotate_left(pos->left_child);
+        }
+        return rotate_right(pos);
     }
-    new_tree->value = value;
-    new_tree->left_child = NULL;
-    new_tree->right_child = NULL;
-    return new_tree;
+    if (balance < -1) {
+        if (height(pos->right_child->right_child) < height(pos->right_child->left_child)) {
+            pos->right_child = rotate_right(pos->right_child);
+        }
+        return rotate_left(pos);
+    }
+    return pos;
 }
 
-BSTreePos bs_tree_insert_left(int value, BSTreePos pos) 
+/**
+ * Inserts a value into a subtree and returns its new root. Sets failed if
+ * the node could not be allocated.
+ */
+static BSTreePos insert_node(BSTreeArena *arena, BSTreePos pos, int value, bool *failed)
 {
     if (pos == NULL) {
-        perror("Error in bs_tree_insert_left: Null position received");
-        return NULL;
+        BSTreePos node = alloc_node(arena, value);
+        if (node == NULL) {
+            *failed = true;
+        }
+        return node;
     }
-    if (pos->left_child != NULL) {
-        perror("Error in bs_tree_insert_left: Left child already exists");
-        return NULL;
+
+    if (value < pos->value) {
+        pos->left_child = insert_node(arena, pos->left_child, value, failed);
+    } else if (value > pos->value) {
+        pos->right_child = insert_node(arena, pos->right_child, value, failed);
+    } else {
+        return pos;
     }
-    BSTreePos new_node = (BSTreePos)malloc(sizeof(struct node));
-    if (new_node == NULL) {
-        perror("Error in bs_tree_insert_left: Memory allocation failed");
-        return NULL;
+    return rebalance(pos);
+}
+
+/**
+ * Unlinks the smallest node of a non-empty subtree, stores it in min and
+ * returns the new root of the subtree.
+ */
+static BSTreePos unlink_min(BSTreePos pos, BSTreePos *min)
+{
+    if (pos->left_child == NULL) {
+        *min = pos;
+        return pos->right_child;
     }
-    new_node->value = value;
-    new_node->left_child = NULL;
-    new_node->right_child = NULL;
-    pos->left_child = new_node;
-    return new_node;
+    pos->left_child = unlink_min(pos->left_child, min);
+    return rebalance(pos);
 }
 
-BSTreePos bs_tree_insert_right(int value, BSTreePos pos) 
+/**
+ * Removes a value from a subtree and returns its new root.
+ */
+static BSTreePos delete_node(BSTreeArena *arena, BSTreePos pos, int value)
 {
     if (pos == NULL) {
-        perror("Error in bs_tree_insert_right: Null position received");
         return NULL;
     }
-    if (pos->right_child != NULL) {
-        perror("Error in bs_tree_insert_right: Right child already exists");
+
+    if (value < pos->value) {
+        pos->left_child = delete_node(arena, pos->left_child, value);
+    } else if (value > pos->value) {
+        pos->right_child = delete_node(arena, pos->right_child, value);
+    } else {
+        BSTreePos left = pos->left_child;
+        BSTreePos right = pos->right_child;
+        free_node(arena, pos);
+
+        if (right == NULL) {
+            return left;
+        }
+
+        // Replace the node with the smallest node of its right subtree
+        BSTreePos successor;
+        right = unlink_min(right, &successor);
+        successor->left_child = left;
+        successor->right_child = right;
+        pos = successor;
+    }
+    return rebalance(pos);
+}
+
+/**
+ * Builds a perfectly balanced tree of the sorted values in [lo, hi) and
+ * returns its root. The nodes are laid out in preorder starting at nodes, so
+ * every node is followed by its left subtree and then its right subtree.
+ */
+static BSTreePos build_sorted(const int *vals, int lo, int hi, BSTreePos nodes)
+{
+    if (lo >= hi) {
         return NULL;
     }
-    BSTreePos new_node = (BSTreePos)malloc(sizeof(struct node));
-    if (new_node == NULL) {
-        perror("Error in bs_tree_insert_right: Memory allocation failed");
+    int mid = lo + (hi - lo) / 2;
+    BSTreePos pos = nodes;
+    pos->value = vals[mid];
+    pos->left_child = build_sorted(vals, lo, mid, nodes + 1);
+    pos->right_child = build_sorted(vals, mid + 1, hi, nodes + 1 + (mid - lo));
+    update_node(pos);
+    return pos;
+}
+
+#ifdef _OPENMP
+/**
+ * Works like build_sorted, but builds large left subtrees as OpenMP tasks.
+ * The subtrees are written to disjoint parts of nodes.
+ */
+static BSTreePos build_sorted_tasks(const int *vals, int lo, int hi, BSTreePos nodes)
+{
+    if (hi - lo < 65536) {
+        return build_sorted(vals, lo, hi, nodes);
+    }
+    int mid = lo + (hi - lo) / 2;
+    BSTreePos pos = nodes;
+    pos->value = vals[mid];
+    #pragma omp task
+    pos->left_child = build_sorted_tasks(vals, lo, mid, nodes + 1);
+    pos->right_child = build_sorted_tasks(vals, mid + 1, hi, nodes + 1 + (mid - lo));
+    #pragma omp taskwait
+    update_node(pos);
+    return pos;
+}
+#endif
+
+/**
+ * Returns true if the values are strictly increasing.
+ */
+static bool is_sorted(const int *vals, size_t n)
+{
+    for (size_t i = 1; i < n; i++) {
+        if (vals[i - 1] >= vals[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Allocates a slab for exactly n nodes in an arena and returns its nodes,
+ * or NULL on allocation failure.
+ */
+static BSTreePos alloc_slab(BSTreeArena *arena, size_t n)
+{
+    struct bs_tree_slab *slab = malloc(sizeof(struct bs_tree_slab) + n * sizeof(struct node));
+    if (slab == NULL) {
         return NULL;
     }
-    new_node->value = value;
-    new_node->left_child = NULL;
-    new_node->right_child = NULL;
-    pos->right_child = new_node;
-    return new_node;
+    slab->capacity = (int)n;
+
+    // Keep the newest slab in front, so its remaining nodes are still used
+    if (arena->slabs == NULL) {
+        slab->next = NULL;
+        arena->slabs = slab;
+        arena->used = slab->capacity;
+    } else {
+        slab->next = arena->slabs->next;
+        arena->slabs->next = slab;
+    }
+    return slab->nodes;
 }
 
-int bs_tree_inspect_label(BSTreePos pos) 
+/**
+ * Counts the values in a tree that are smaller than value, or smaller than
+ * or equal to it if inclusive is set.
+ */
+static int count_below(BSTreePos pos, int value, bool inclusive)
 {
-    if (pos == NULL) {
-        perror("Error in bs_tree_inspect_label: Null position received");
-        return 1;
+    int count = 0;
+    while (pos != NULL) {
+        if (pos->value < value || (inclusive && pos->value == value)) {
+            count += size(pos->left_child) + 1;
+            pos = pos->right_child;
+        } else {
+            pos = pos->left_child;
+        }
     }
-    return pos->value;
+    return count;
 }
 
-bool bs_tree_has_left_child(BSTreePos pos) 
+/**
+ * Pushes pos and its chain of left children onto the stack of an iterator.
+ */
+static void push_left_spine(BSTreeIter *iter, BSTreePos pos)
 {
-    if (pos == NULL) {
-        perror("Error in bs_tree_has_left_child: Null position received");
-        return false;
+    while (pos != NULL && iter->top < BS_TREE_MAX_HEIGHT) {
+        iter->stack[iter->top++] = pos;
+        pos = pos->left_child;
     }
-    return pos->left_child != NULL;
 }
 
-bool bs_tree_has_right_child(BSTreePos pos) 
+/**
+ * Adds a reference to a persistent node and returns it.
+ */
+static VersionPos retain(VersionPos pos)
 {
-    if (pos == NULL) {
-        perror("Error in bs_tree_has_right_child: Null position received");
-        return false;
+    if (pos != NULL) {
+        atomic_fetch_add_explicit(&pos->refs, 1, memory_order_relaxed);
     }
-    return pos->right_child != NULL;
+    return pos;
 }
 
-BSTreePos bs_tree_root(BSTree *tree) 
+/**
+ * Drops a reference to a persistent node, freeing it and releasing its
+ * children when it was the last one.
+ */
+static void release(VersionPos pos)
 {
-    if (tree == NULL) {
-        perror("Error in bs_tree_root: Null tree received");
+    while (pos != NULL && atomic_fetch_sub_explicit(&pos->refs, 1, memory_order_acq_rel) == 1) {
+        release(pos->left_child);
+        VersionPos right = pos->right_child;
+        free(pos);
+        pos = right;
+    }
+}
+
+/**
+ * Returns the height of a persistent subtree, 0 for an empty one.
+ */
+static int version_height(VersionPos pos)
+{
+    return pos != NULL ? pos->height : 0;
+}
+
+/**
+ * Returns the number of nodes in a persistent subtree, 0 for an empty one.
+ */
+static int version_size(VersionPos pos)
+{
+    return pos != NULL ? pos->size : 0;
+}
+
+/**
+ * Recomputes the height and size of a persistent node from its children.
+ */
+static void update_version(VersionPos pos)
+{
+    int left = version_height(pos->left_child);
+    int right = version_height(pos->right_child);
+    pos->height = (left > right ? left : right) + 1;
+    pos->size = version_size(pos->left_child) + version_size(pos->right_child) + 1;
+}
+
+/**
+ * Creates a persistent node that takes over the given references to its
+ * children. On allocation failure the references are dropped, failed is set
+ * and NULL is returned.
+ */
+static VersionPos make_version(int value, VersionPos left, VersionPos right, bool *failed)
+{
+    VersionPos pos = malloc(sizeof(struct bs_tree_version));
+    if (pos == NULL) {
+        release(left);
+        release(right);
+        *failed = true;
         return NULL;
     }
-    return tree;
+    pos->value = value;
+    atomic_init(&pos->refs, 1);
+    pos->left_child = left;
+    pos->right_child = right;
+    update_version(pos);
+    return pos;
 }
 
-BSTreePos bs_tree_left_child(BSTreePos pos) 
+/**
+ * Returns a node that may be changed in place of pos, which the caller holds
+ * a reference to. If that is the only reference, no other version can reach
+ * pos and it is returned as is; otherwise it is replaced by a copy. On
+ * allocation failure failed is set and pos is returned.
+ */
+static VersionPos version_unshare(VersionPos pos, bool *failed)
+{
+    if (atomic_load_explicit(&pos->refs, memory_order_acquire) == 1) {
+        return pos;
+    }
+    VersionPos copy = make_version(pos->value, retain(pos->left_child), retain(pos->right_child), failed);
+    if (copy == NULL) {
+        return pos;
+    }
+    release(pos);
+    return copy;
+}
+
+/**
+ * Rotates an unshared persistent subtree with an unshared left child to the
+ * right and returns its new root.
+ */
+static VersionPos version_rotate_right(VersionPos pos)
+{
+    VersionPos left = pos->left_child;
+    pos->left_child = left->right_child;
+    left->right_child = pos;
+    update_version(pos);
+    update_version(left);
+    return left;
+}
+
+/**
+ * Rotates an unshared persistent subtree with an unshared right child to the
+ * left and returns its new root.
+ */
+static VersionPos version_rotate_left(VersionPos pos)
+{
+    VersionPos right = pos->right_child;
+    pos->right_child = right->left_child;
+    right->left_child = pos;
+    update_version(pos);
+    update_version(right);
+    return right;
+}
+
+/**
+ * Works like rebalance on a new, unshared persistent node. The nodes below
+ * it that are rotated are copied first if other versions share them. On
+ * allocation failure the node is released, failed is set and NULL is returned.
+ */
+static VersionPos version_rebalance(VersionPos pos, bool *failed)
 {
     if (pos == NULL) {
-        perror("Error in bs_tree_left_child: Null position received");
         return NULL;
     }
-    return pos->left_child;
+    int balance = version_height(pos->left_child) - version_height(pos->right_child);
+
+    if (balance > 1) {
+        VersionPos left = pos->left_child = version_unshare(pos->left_child, failed);
+        if (!*failed && version_height(left->left_child) < version_height(left->right_child)) {
+            left->right_child = version_unshare(left->right_child, failed);
+            if (!*failed) {
+                pos->left_child = version_rotate_left(left);
+            }
+        }
+        if (*failed) {
+            release(pos);
+            return NULL;
+        }
+        return version_rotate_right(pos);
+    }
+    if (balance < -1) {
+        VersionPos right = pos->right_child = version_unshare(pos->right_child, failed);
+        if (!*failed && version_height(right->right_child) < version_height(right->left_child)) {
+            right->left_child = version_unshare(right->left_child, failed);
+            if (!*failed) {
+                pos->right_child = version_rotate_right(right);
+            }
+        }
+        if (*failed) {
+            release(pos);
+            return NULL;
+        }
+        return version_rotate_left(pos);
+    }
+    return pos;
 }
 
-BSTreePos bs_tree_right_child(BSTreePos pos) 
+/**
+ * Inserts a value into a persistent subtree by copying the path to it, and
+ * returns a reference to the new subtree. The old subtree is unchanged.
+ */
+static VersionPos version_insert(VersionPos pos, int value, bool *failed)
 {
     if (pos == NULL) {
-        perror("Error in bs_tree_right_child: Null position received");
+        return make_version(value, NULL, NULL, failed);
+    }
+    if (value == pos->value) {
+        return retain(pos);
+    }
+
+    VersionPos copy;
+    if (value < pos->value) {
+        VersionPos left = version_insert(pos->left_child, value, failed);
+        if (*failed) {
+            return NULL;
+        }
+        copy = make_version(pos->value, left, retain(pos->right_child), failed);
+    } else {
+        VersionPos right = version_insert(pos->right_child, value, failed);
+        if (*failed) {
+            return NULL;
+        }
+        copy = make_version(pos->value, retain(pos->left_child), right, failed);
+    }
+    return version_rebalance(copy, failed);
+}
+
+/**
+ * Removes the smallest value of a non-empty persistent subtree by copying the
+ * path to it. Stores the value in min and returns a reference to the new subtree.
+ */
+static VersionPos version_unlink_min(VersionPos pos, int *min, bool *failed)
+{
+    if (pos->left_child == NULL) {
+        *min = pos->value;
+        return retain(pos->right_child);
+    }
+    VersionPos left = version_unlink_min(pos->left_child, min, failed);
+    if (*failed) {
         return NULL;
     }
-    return pos->right_child;
+    VersionPos copy = make_version(pos->value, left, retain(pos->right_child), failed);
+    return version_rebalance(copy, failed);
+}
+
+/**
+ * Removes a value that is in a persistent subtree by copying the path to it,
+ * and returns a reference to the new subtree. The old subtree is unchanged.
+ */
+static VersionPos version_delete(VersionPos pos, int value, bool *failed)
+{
+    VersionPos copy;
+    if (value < pos->value) {
+        VersionPos left = version_delete(pos->left_child, value, failed);
+        if (*failed) {
+            return NULL;
+        }
+        copy = make_version(pos->value, left, retain(pos->right_child), failed);
+    } else if (value > pos->value) {
+        VersionPos right = version_delete(pos->right_child, value, failed);
+        if (*failed) {
+            return NULL;
+        }
+        copy = make_version(pos->value, retain(pos->left_child), right, failed);
+    } else if (pos->right_child == NULL) {
+        return retain(pos->left_child);
+    } else {
+        // Replace the value with the smallest value of the right subtree
+        int successor;
+        VersionPos right = version_unlink_min(pos->right_child, &successor, failed);
+        if (*failed) {
+            return NULL;
+        }
+        copy = make_version(successor, retain(pos->left_child), right, failed);
+    }
+    return version_rebalance(copy, failed);
+}
+
+/**
+ * Releases the replaced versions of a concurrent tree that no reader can
+ * hold any longer.
+ *
+ * A reader that announced epoch e may hold any version that was current in
+ * epoch e or later, so a version replaced in epoch r is safe to release once
+ * every reader has announced an epoch of at least r.
+ */
+static void concurrent_reclaim(BSTreeConcurrent *tree)
+{
+    long long oldest = READER_IDLE;
+    for (int i = 0; i < tree->max_readers; i++) {
+        long long e = atomic_load(&tree->announced[i]);
+        if (e < oldest) {
+            oldest = e;
+        }
+    }
+
+    struct bs_tree_retired **link = &tree->retired;
+    while (*link != NULL) {
+        struct bs_tree_retired *retired = *link;
+        if (retired->retired <= oldest) {
+            *link = retired->next;
+            release(retired->version);
+            free(retired);
+        } else {
+            link = &retired->next;
+        }
+    }
+}
+
+/**
+ * Publishes a new version of a concurrent tree, which the caller holds the
+ * writer lock and a reference to, and retires the old one. Returns false if
+ * the retirement record could not be allocated, in which case the new
+ * version is released instead.
+ */
+static bool concurrent_publish(BSTreeConcurrent *tree, BSTreeVersion *version)
+{
+    struct bs_tree_retired *retired = malloc(sizeof(struct bs_tree_retired));
+    if (retired == NULL) {
+        release(version);
+        return false;
+    }
+
+    // Publish the new version, then retire the old one in the next epoch
+    retired->version = atomic_exchange(&tree->current, version);
+    retired->retired = atomic_fetch_add(&tree->epoch, 1) + 1;
+    retired->next = tree->retired;
+    tree->retired = retired;
+
+    concurrent_reclaim(tree);
+    return true;
+}
+
+/**
+ * Visits the values of a tree in order without recursion or a stack.
+ *
+ * Every node's in-order predecessor temporarily gets a right link back to the
+ * node, which is removed again when the node is reached the second time. If
+ * values is not NULL, the values are stored in it. Returns the number of
+ * values, or -1 if they are not strictly increasing.
+ */
+static int morris_in_order(BSTreePos pos, int *values)
+{
+    int count = 0;
+    bool ordered = true;
+    int previous = 0;
+
+    while (pos != NULL) {
+        if (pos->left_child != NULL) {
+            BSTreePos pred = pos->left_child;
+            while (pred->right_child != NULL && pred->right_child != pos) {
+                pred = pred->right_child;
+            }
+            if (pred->right_child == NULL) {
+                // Thread the predecessor to pos and descend to the left
+                pred->right_child = pos;
+                pos = pos->left_child;
+                continue;
+            }
+            // Returned through the thread, remove it
+            pred->right_child = NULL;
+        }
+
+        if (count > 0 && pos->value <= previous) {
+            ordered = false;
+        }
+        if (values != NULL) {
+            values[count] = pos->value;
+        }
+        previous = pos->value;
+        count++;
+        pos = pos->right_child;
+    }
+
+    return ordered ? count : -1;
+}
+
+/**
+ * Returns the FNV-1a hash of the keys of a frozen tree, as stored in the
+ * files written by bs_tree_save.
+ */
+static uint64_t frozen_checksum(const BSTreeFrozen *frozen)
+{
+    const unsigned char *p = (const unsigned char *)frozen->keys;
+    size_t size = ((size_t)frozen->n + 1) * sizeof(int);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Copies sorted values into Eytzinger order, starting at position k.
+ */
+static int eytzinger_fill(const int *sorted, int n, int i, int *keys, int k)
+{
+    if (k <= n) {
+        i = eytzinger_fill(sorted, n, i, keys, 2 * k);
+        keys[k] = sorted[i++];
+        i = eytzinger_fill(sorted, n, i, keys, 2 * k + 1);
+    }
+    return i;
+}
+
+/* ---------------------- External functions ---------------------- */
+
+BSTree *bs_tree_make(int value) 
+{
+    BSTree *new_tree = (BSTree *)malloc(sizeof(BSTree));
+    if (new_tree == NULL) {
+        perror("Error in bs_tree_make: Memory allocation failed");
+        return NULL;
+    }
+    new_tree->value = value;
+    new_tree->height = 1;
+    new_tree->size = 1;
+    new_tree->left_child = NULL;
+    new_tree->right_child = NULL;
+    return new_tree;
+}
+
+BSTreePos bs_tree_insert_left(int value, BSTreePos pos) 
+{
+    if (pos == NULL) {
+        perror("Error in bs_tree_insert_left: Null position received");
+        return NULL;
+    }
+    if (pos->left_child != NULL) {
+        perror("Error in bs_tree_insert_left: Left child already exists");
+        return NULL;
+    }
+    BSTreePos new_node = (BSTreePos)malloc(sizeof(struct node));
+    if (new_node == NULL) {
+        perror("Error in bs_tree_insert_left: Memory allocation failed");
+        return NULL;
+    }
+    new_node->value = value;
+    new_node->height = 1;
+    new_node->size = 1;
+    new_node->left_child = NULL;
+    new_node->right_child = NULL;
+    pos->left_child = new_node;
+    return new_node;
+}
+
+BSTreePos bs_tree_insert_right(int value, BSTreePos pos) 
+{
+    if (pos == NULL) {
+        perror("Error in bs_tree_insert_right: Null position received");
+        return NULL;
+    }
+    if (pos->right_child != NULL) {
+        perror("Error in bs_tree_insert_right: Right child already exists");
+        return NULL;
+    }
+    BSTreePos new_node = (BSTreePos)malloc(sizeof(struct node));
+    if (new_node == NULL) {
+        perror("Error in bs_tree_insert_right: Memory allocation failed");
+        return NULL;
+    }
+    new_node->value = value;
+    new_node->height = 1;
+    new_node->size = 1;
+    new_node->left_child = NULL;
+    new_node->right_child = NULL;
+    pos->right_child = new_node;
+    return new_node;
+}
+
+int bs_tree_inspect_label(BSTreePos pos) 
+{
+    if (pos == NULL) {
+        perror("Error in bs_tree_inspect_label: Null position received");
+        return 1;
+    }
+    return pos->value;
+}
+
+bool bs_tree_has_left_child(BSTreePos pos) 
+{
+    if (pos == NULL) {
+        perror("Error in bs_tree_has_left_child: Null position received");
+        return false;
+    }
+    return pos->left_child != NULL;
+}
+
+bool bs_tree_has_right_child(BSTreePos pos) 
+{
+    if (pos == NULL) {
+        perror("Error in bs_tree_has_right_child: Null position received");
+        return false;
+    }
+    return pos->right_child != NULL;
+}
+
+BSTreePos bs_tree_root(BSTree *tree) 
+{
+    if (tree == NULL) {
+        perror("Error in bs_tree_root: Null tree received");
+        return NULL;
+    }
+    return tree;
+}
+
+BSTreePos bs_tree_left_child(BSTreePos pos) 
+{
+    if (pos == NULL) {
+        perror("Error in bs_tree_left_child: Null position received");
+        return NULL;
+    }
+    return pos->left_child;
+}
+
+BSTreePos bs_tree_right_child(BSTreePos pos) 
+{
+    if (pos == NULL) {
+        perror("Error in bs_tree_right_child: Null position received");
+        return NULL;
+    }
+    return pos->right_child;
+}
+
+BSTree *bs_tree_insert(BSTree *tree, int value)
+{
+    bool failed = false;
+    BSTree *root = insert_node(NULL, tree, value, &failed);
+    if (failed) {
+        perror("Error in bs_tree_insert: Memory allocation failed");
+    }
+    return root;
+}
+
+BSTreePos bs_tree_find(BSTree *tree, int value)
+{
+    BSTreePos pos = tree;
+    while (pos != NULL && pos->value != value) {
+        pos = value < pos->value ? pos->left_child : pos->right_child;
+    }
+    return pos;
+}
+
+BSTree *bs_tree_delete(BSTree *tree, int value)
+{
+    return delete_node(NULL, tree, value);
+}
+
+int bs_tree_height(BSTree *tree)
+{
+    return height(tree);
+}
+
+int bs_tree_size(BSTree *tree)
+{
+    return size(tree);
+}
+
+int bs_tree_rank(BSTree *tree, int value)
+{
+    return count_below(tree, value, false);
+}
+
+BSTreePos bs_tree_select(BSTree *tree, int k)
+{
+    BSTreePos pos = tree;
+    while (pos != NULL) {
+        int left = size(pos->left_child);
+        if (k < left) {
+            pos = pos->left_child;
+        } else if (k > left) {
+            k -= left + 1;
+            pos = pos->right_child;
+        } else {
+            return pos;
+        }
+    }
+    return NULL;
+}
+
+int bs_tree_count_range(BSTree *tree, int lo, int hi)
+{
+    if (lo > hi) {
+        return 0;
+    }
+    return count_below(tree, hi, true) - count_below(tree, lo, false);
+}
+
+void bs_tree_range_begin(BSTreeIter *iter, BSTree *tree, int lo, int hi)
+{
+    iter->top = 0;
+    iter->hi = hi;
+
+    // Keep the path to the first value >= lo, skipping the smaller ancestors
+    BSTreePos pos = tree;
+    while (pos != NULL && iter->top < BS_TREE_MAX_HEIGHT) {
+        if (pos->value >= lo) {
+            iter->stack[iter->top++] = pos;
+            pos = pos->left_child;
+        } else {
+            pos = pos->right_child;
+        }
+    }
+}
+
+BSTreePos bs_tree_range_next(BSTreeIter *iter)
+{
+    if (iter->top == 0) {
+        return NULL;
+    }
+    BSTreePos pos = iter->stack[--iter->top];
+    if (pos->value > iter->hi) {
+        iter->top = 0;
+        return NULL;
+    }
+    push_left_spine(iter, pos->right_child);
+    return pos;
+}
+
+BSTreeArena *bs_tree_arena_create(int slab_capacity)
+{
+    BSTreeArena *arena = malloc(sizeof(BSTreeArena));
+    if (arena == NULL) {
+        perror("Error in bs_tree_arena_create: Memory allocation failed");
+        return NULL;
+    }
+    arena->slab_capacity = slab_capacity > 0 ? slab_capacity : 4096;
+    arena->used = 0;
+    arena->slabs = NULL;
+    arena->free_nodes = NULL;
+    return arena;
+}
+
+BSTree *bs_tree_arena_make(BSTreeArena *arena, int value)
+{
+    if (arena == NULL) {
+        perror("Error in bs_tree_arena_make: Null arena received");
+        return NULL;
+    }
+    BSTree *tree = alloc_node(arena, value);
+    if (tree == NULL) {
+        perror("Error in bs_tree_arena_make: Memory allocation failed");
+    }
+    return tree;
+}
+
+BSTree *bs_tree_arena_insert(BSTreeArena *arena, BSTree *tree, int value)
+{
+    if (arena == NULL) {
+        perror("Error in bs_tree_arena_insert: Null arena received");
+        return tree;
+    }
+    bool failed = false;
+    BSTree *root = insert_node(arena, tree, value, &failed);
+    if (failed) {
+        perror("Error in bs_tree_arena_insert: Memory allocation failed");
+    }
+    return root;
+}
+
+BSTree *bs_tree_arena_delete(BSTreeArena *arena, BSTree *tree, int value)
+{
+    if (arena == NULL) {
+        perror("Error in bs_tree_arena_delete: Null arena received");
+        return tree;
+    }
+    return delete_node(arena, tree, value);
+}
+
+void bs_tree_arena_destroy(BSTreeArena *arena)
+{
+    if (arena == NULL) {
+        perror("Error in bs_tree_arena_destroy: Null arena received");
+        return;
+    }
+    while (arena->slabs != NULL) {
+        struct bs_tree_slab *next = arena->slabs->next;
+        free(arena->slabs);
+        arena->slabs = next;
+    }
+    free(arena);
+}
+
+BSTree *bs_tree_from_sorted(BSTreeArena *arena, const int *vals, size_t n)
+{
+    if (arena == NULL || (vals == NULL && n > 0)) {
+        perror("Error in bs_tree_from_sorted: Null arena or values received");
+        return NULL;
+    }
+    if (n > INT_MAX || !is_sorted(vals, n)) {
+        perror("Error in bs_tree_from_sorted: Values are not strictly increasing or too many");
+        return NULL;
+    }
+    if (n == 0) {
+        return NULL;
+    }
+    BSTreePos nodes = alloc_slab(arena, n);
+    if (nodes == NULL) {
+        perror("Error in bs_tree_from_sorted: Memory allocation failed");
+        return NULL;
+    }
+    return build_sorted(vals, 0, (int)n, nodes);
+}
+
+BSTree *bs_tree_from_sorted_parallel(BSTreeArena *arena, const int *vals, size_t n)
+{
+    if (arena == NULL || (vals == NULL && n > 0)) {
+        perror("Error in bs_tree_from_sorted_parallel: Null arena or values received");
+        return NULL;
+    }
+    if (n > INT_MAX || !is_sorted(vals, n)) {
+        perror("Error in bs_tree_from_sorted_parallel: Values are not strictly increasing or too many");
+        return NULL;
+    }
+    if (n == 0) {
+        return NULL;
+    }
+    BSTreePos nodes = alloc_slab(arena, n);
+    if (nodes == NULL) {
+        perror("Error in bs_tree_from_sorted_parallel: Memory allocation failed");
+        return NULL;
+    }
+
+    BSTree *tree;
+#ifdef _OPENMP
+    #pragma omp parallel
+    #pragma omp single
+    tree = build_sorted_tasks(vals, 0, (int)n, nodes);
+#else
+    tree = build_sorted(vals, 0, (int)n, nodes);
+#endif
+    return tree;
+}
+
+BSTreeVersion *bs_tree_version_insert(BSTreeVersion *version, int value)
+{
+    bool failed = false;
+    BSTreeVersion *result = version_insert(version, value, &failed);
+    if (failed) {
+        perror("Error in bs_tree_version_insert: Memory allocation failed");
+        return retain(version);
+    }
+    return result;
+}
+
+BSTreeVersion *bs_tree_version_delete(BSTreeVersion *version, int value)
+{
+    if (!bs_tree_version_contains(version, value)) {
+        return retain(version);
+    }
+    bool failed = false;
+    BSTreeVersion *result = version_delete(version, value, &failed);
+    if (failed) {
+        perror("Error in bs_tree_version_delete: Memory allocation failed");
+        return retain(version);
+    }
+    return result;
+}
+
+bool bs_tree_version_contains(const BSTreeVersion *version, int value)
+{
+    const struct bs_tree_version *pos = version;
+    while (pos != NULL && pos->value != value) {
+        pos = value < pos->value ? pos->left_child : pos->right_child;
+    }
+    return pos != NULL;
+}
+
+bool bs_tree_version_select(const BSTreeVersion *version, int k, int *result)
+{
+    const struct bs_tree_version *pos = version;
+    while (pos != NULL) {
+        int left = version_size(pos->left_child);
+        if (k < left) {
+            pos = pos->left_child;
+        } else if (k > left) {
+            k -= left + 1;
+            pos = pos->right_child;
+        } else {
+            if (result != NULL) {
+                *result = pos->value;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+int bs_tree_version_size(const BSTreeVersion *version)
+{
+    return version != NULL ? version->size : 0;
+}
+
+BSTreeVersion *bs_tree_version_snapshot(BSTreeVersion *version)
+{
+    return retain(version);
+}
+
+void bs_tree_version_release(BSTreeVersion *version)
+{
+    release(version);
+}
+
+BSTreeConcurrent *bs_tree_concurrent_create(int max_readers)
+{
+    if (max_readers < 0) {
+        perror("Error in bs_tree_concurrent_create: Invalid parameters");
+        return NULL;
+    }
+
+    BSTreeConcurrent *tree = malloc(sizeof(BSTreeConcurrent));
+    atomic_int *registered = malloc((max_readers > 0 ? max_readers : 1) * sizeof(atomic_int));
+    atomic_llong *announced = malloc((max_readers > 0 ? max_readers : 1) * sizeof(atomic_llong));
+    if (!tree || !registered || !announced) {
+        perror("Error in bs_tree_concurrent_create: Memory allocation failed");
+        free(tree);
+        free(registered);
+        free(announced);
+        return NULL;
+    }
+
+    atomic_init(&tree->current, NULL);
+    atomic_init(&tree->epoch, 0);
+    tree->max_readers = max_readers;
+    tree->registered = registered;
+    tree->announced = announced;
+    atomic_flag_clear(&tree->writer);
+    tree->retired = NULL;
+
+    for (int i = 0; i < max_readers; i++) {
+        atomic_init(&registered[i], 0);
+        atomic_init(&announced[i], READER_IDLE);
+    }
+
+    return tree;
+}
+
+int bs_tree_concurrent_reader_register(BSTreeConcurrent *tree)
+{
+    if (tree == NULL) {
+        perror("Error in bs_tree_concurrent_reader_register: Null tree received");
+        return -1;
+    }
+    for (int i = 0; i < tree->max_readers; i++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&tree->registered[i], &expected, 1)) {
+            return i;
+        }
+    }
+    perror("Error in bs_tree_concurrent_reader_register: No free reader slot");
+    return -1;
+}
+
+void bs_tree_concurrent_reader_unregister(BSTreeConcurrent *tree, int slot)
+{
+    if (tree == NULL || slot < 0 || slot >= tree->max_readers) {
+        perror("Error in bs_tree_concurrent_reader_unregister: Invalid parameters");
+        return;
+    }
+    atomic_store(&tree->announced[slot], READER_IDLE);
+    atomic_store(&tree->registered[slot], 0);
+}
+
+const BSTreeVersion *bs_tree_concurrent_read_begin(BSTreeConcurrent *tree, int slot)
+{
+    if (tree == NULL || slot < 0 || slot >= tree->max_readers) {
+        perror("Error in bs_tree_concurrent_read_begin: Invalid parameters");
+        return NULL;
+    }
+
+    // The announcement must be visible before the version is loaded, so that
+    // a writer replacing the version either sees it or is seen by the load
+    atomic_store(&tree->announced[slot], atomic_load(&tree->epoch));
+    return atomic_load(&tree->current);
+}
+
+void bs_tree_concurrent_read_end(BSTreeConcurrent *tree, int slot)
+{
+    if (tree == NULL || slot < 0 || slot >= tree->max_readers) {
+        perror("Error in bs_tree_concurrent_read_end: Invalid parameters");
+        return;
+    }
+    atomic_store(&tree->announced[slot], READER_IDLE);
+}
+
+bool bs_tree_concurrent_contains(BSTreeConcurrent *tree, int slot, int value)
+{
+    if (tree == NULL || slot < 0 || slot >= tree->max_readers) {
+        perror("Error in bs_tree_concurrent_contains: Invalid parameters");
+        return false;
+    }
+    atomic_store(&tree->announced[slot], atomic_load(&tree->epoch));
+    bool found = bs_tree_version_contains(atomic_load(&tree->current), value);
+    atomic_store(&tree->announced[slot], READER_IDLE);
+    return found;
+}
+
+bool bs_tree_concurrent_insert(BSTreeConcurrent *tree, int value)
+{
+    if (tree == NULL) {
+        perror("Error in bs_tree_concurrent_insert: Null tree received");
+        return false;
+    }
+
+    while (atomic_flag_test_and_set(&tree->writer)) {
+        // Another writer is changing the tree, let it run if it was preempted
+        sched_yield();
+    }
+
+    BSTreeVersion *old = atomic_load(&tree->current);
+    bool ok = true;
+    if (!bs_tree_version_contains(old, value)) {
+        bool failed = false;
+        BSTreeVersion *version = version_insert(old, value, &failed);
+        ok = !failed && concurrent_publish(tree, version);
+    }
+
+    atomic_flag_clear(&tree->writer);
+    if (!ok) {
+        perror("Error in bs_tree_concurrent_insert: Memory allocation failed");
+    }
+    return ok;
+}
+
+bool bs_tree_concurrent_delete(BSTreeConcurrent *tree, int value)
+{
+    if (tree == NULL) {
+        perror("Error in bs_tree_concurrent_delete: Null tree received");
+        return false;
+    }
+
+    while (atomic_flag_test_and_set(&tree->writer)) {
+        // Another writer is changing the tree, let it run if it was preempted
+        sched_yield();
+    }
+
+    BSTreeVersion *old = atomic_load(&tree->current);
+    bool ok = true;
+    if (bs_tree_version_contains(old, value)) {
+        bool failed = false;
+        BSTreeVersion *version = version_delete(old, value, &failed);
+        ok = !failed && concurrent_publish(tree, version);
+    }
+
+    atomic_flag_clear(&tree->writer);
+    if (!ok) {
+        perror("Error in bs_tree_concurrent_delete: Memory allocation failed");
+    }
+    return ok;
+}
+
+long long bs_tree_concurrent_version(BSTreeConcurrent *tree)
+{
+    if (tree == NULL) {
+        perror("Error in bs_tree_concurrent_version: Null tree received");
+        return -1;
+    }
+    return atomic_load(&tree->epoch);
+}
+
+void bs_tree_concurrent_destroy(BSTreeConcurrent *tree)
+{
+    if (tree == NULL) {
+        perror("Error in bs_tree_concurrent_destroy: Null tree received");
+        return;
+    }
+
+    release(atomic_load(&tree->current));
+    while (tree->retired != NULL) {
+        struct bs_tree_retired *next = tree->retired->next;
+        release(tree->retired->version);
+        free(tree->retired);
+        tree->retired = next;
+    }
+
+    free(tree->registered);
+    free(tree->announced);
+    free(tree);
+}
+
+BSTreeFrozen *bs_tree_freeze(BSTree *tree)
+{
+    int n = morris_in_order(tree, NULL);
+    if (n < 0) {
+        perror("Error in bs_tree_freeze: Tree is not ordered");
+        return NULL;
+    }
+
+    BSTreeFrozen *frozen = malloc(sizeof(BSTreeFrozen));
+    int *sorted = malloc((n > 0 ? n : 1) * sizeof(int));
+    // Align the keys to cache lines, so that the lower bound search can
+    // prefetch 16 descendants at a time
+    size_t keys_size = ((size_t)(n + 1) * sizeof(int) + 63) / 64 * 64;
+    int *keys = aligned_alloc(64, keys_size);
+    if (frozen == NULL || sorted == NULL || keys == NULL) {
+        perror("Error in bs_tree_freeze: Memory allocation failed");
+        free(frozen);
+        free(sorted);
+        free(keys);
+        return NULL;
+    }
+
+    morris_in_order(tree, sorted);
+    eytzinger_fill(sorted, n, 0, keys, 1);
+    free(sorted);
+
+    keys[0] = 0;
+    frozen->n = n;
+    frozen->keys = keys;
+    frozen->mapping = NULL;
+    frozen->mapping_size = 0;
+    return frozen;
+}
+
+bool bs_tree_frozen_lower_bound(const BSTreeFrozen *frozen, int value, int *result)
+{
+    if (frozen == NULL) {
+        perror("Error in bs_tree_frozen_lower_bound: Null pointer received");
+        return false;
+    }
+
+    const int *keys = frozen->keys;
+    unsigned long k = 1;
+    while (k <= (unsigned long)frozen->n) {
+#if defined(__GNUC__) || defined(__clang__)
+        // The 16 descendants four levels down share one cache line
+        if (16 * k <= (unsigned long)frozen->n) {
+            __builtin_prefetch(keys + 16 * k);
+        }
+#endif
+        k = 2 * k + (keys[k] < value);
+    }
+
+    // The path went right from every key smaller than value. Dropping the
+    // trailing right turns and the final left turn gives the answer.
+    while (k & 1) {
+        k >>= 1;
+    }
+    k >>= 1;
+
+    if (k == 0) {
+        return false;
+    }
+    if (result != NULL) {
+        *result = keys[k];
+    }
+    return true;
+}
+
+void bs_tree_frozen_destroy(BSTreeFrozen *frozen)
+{
+    if (frozen == NULL) {
+        perror("Error in bs_tree_frozen_destroy: Null pointer received");
+        return;
+    }
+    if (frozen->mapping != NULL) {
+        munmap(frozen->mapping, frozen->mapping_size);
+    } else {
+        free(frozen->keys);
+    }
+    free(frozen);
+}
+
+bool bs_tree_save(BSTree *tree, const char *path)
+{
+    if (path == NULL) {
+        perror("Error in bs_tree_save: Null path received");
+        return false;
+    }
+
+    BSTreeFrozen *frozen = bs_tree_freeze(tree);
+    char *tmp_path = malloc(strlen(path) + 5);
+    if (frozen == NULL || tmp_path == NULL) {
+        perror("Error in bs_tree_save: Tree is not ordered or allocation failed");
+        if (frozen != NULL) {
+            bs_tree_frozen_destroy(frozen);
+        }
+        free(tmp_path);
+        return false;
+    }
+    strcpy(tmp_path, path);
+    strcat(tmp_path, ".tmp");
+
+    struct bs_tree_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BS_TREE_FILE_MAGIC, sizeof(header.magic));
+    header.version = BS_TREE_FILE_VERSION;
+    header.byte_order = BS_TREE_FILE_BYTE_ORDER;
+    header.n = frozen->n;
+    header.checksum = frozen_checksum(frozen);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    bool ok = fp != NULL
+              && fwrite(&header, sizeof(header), 1, fp) == 1
+              && fwrite(frozen->keys, sizeof(int), frozen->n + 1, fp) == (size_t)frozen->n + 1;
+    if (fp != NULL && fclose(fp) != 0) {
+        ok = false;
+    }
+    if (ok && rename(tmp_path, path) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        perror("Error in bs_tree_save: Could not write file");
+        remove(tmp_path);
+    }
+
+    bs_tree_frozen_destroy(frozen);
+    free(tmp_path);
+    return ok;
+}
+
+BSTreeFrozen *bs_tree_load(const char *path, bool verify)
+{
+    if (path == NULL) {
+        perror("Error in bs_tree_load: Null path received");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("Error in bs_tree_load: Could not open file");
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(struct bs_tree_file_header)) {
+        perror("Error in bs_tree_load: File is too small");
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Error in bs_tree_load: Could not map file");
+        return NULL;
+    }
+
+    const struct bs_tree_file_header *header = data;
+    bool ok = memcmp(header->magic, BS_TREE_FILE_MAGIC, sizeof(header->magic)) == 0
+              && header->version == BS_TREE_FILE_VERSION
+              && header->byte_order == BS_TREE_FILE_BYTE_ORDER
+              && header->n >= 0
+              && size == sizeof(*header) + ((size_t)header->n + 1) * sizeof(int);
+
+    BSTreeFrozen *frozen = ok ? malloc(sizeof(BSTreeFrozen)) : NULL;
+    if (frozen != NULL) {
+        frozen->n = header->n;
+        frozen->keys = (int *)((char *)data + sizeof(*header));
+        frozen->mapping = data;
+        frozen->mapping_size = size;
+        if (verify && frozen_checksum(frozen) != header->checksum) {
+            free(frozen);
+            frozen = NULL;
+        }
+    }
+
+    if (frozen == NULL) {
+        perror("Error in bs_tree_load: Invalid or corrupt file");
+        munmap(data, size);
+    }
+    return frozen;
 }
 
 void bs_tree_destroy(BSTree *tree) 
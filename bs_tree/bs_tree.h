@@ -2,6 +2,7 @@
 #define BS_TREE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @defgroup bs_tree_h Binary Search Tree
@@ -30,6 +31,8 @@
  */
 struct node {
     int value;                /**< The value of the node. **/
+    int height;               /**< Height of the subtree, kept up to date by the keyed functions. **/
+    int size;                 /**< Number of nodes in the subtree, kept up to date by the keyed functions. **/
     struct node *left_child;  /**< Pointer to the left child. **/
     struct node *right_child; /**< Pointer to the right child. **/
 };
@@ -37,6 +40,88 @@ struct node {
 typedef struct node BSTree;
 typedef struct node* BSTreePos;
 
+/**
+ * @brief Upper bound on the height of a tree built by the keyed functions.
+ *
+ * An AVL tree of height 48 has more than INT_MAX nodes.
+ */
+#define BS_TREE_MAX_HEIGHT 48
+
+/**
+ * @brief In-order iterator over the values of a tree within a range.
+ *
+ * The iterator keeps the path to the next value in a fixed-size stack, so it
+ * can live on the caller's stack and never allocates. The tree must not be
+ * changed while it is iterated.
+ */
+typedef struct bs_tree_iter {
+    BSTreePos stack[BS_TREE_MAX_HEIGHT];  /**< Nodes whose value and right subtree are still to be visited. **/
+    int top;                              /**< Number of nodes on the stack. **/
+    int hi;                               /**< The largest value to visit. **/
+} BSTreeIter;
+
+/**
+ * @brief A block of nodes allocated at once by an arena.
+ */
+struct bs_tree_slab {
+    struct bs_tree_slab *next;  /**< The previously allocated slab. **/
+    int capacity;               /**< Number of nodes in the slab. **/
+    struct node nodes[];        /**< The nodes. **/
+};
+
+/**
+ * @brief Allocator that hands out tree nodes from large contiguous slabs.
+ *
+ * Nodes of trees built through an arena are never freed one by one. Nodes
+ * removed by bs_tree_arena_delete are kept for reuse, and all nodes are
+ * released at once by bs_tree_arena_destroy.
+ */
+typedef struct bs_tree_arena {
+    int slab_capacity;           /**< Number of nodes in every new slab. **/
+    int used;                    /**< Number of nodes handed out from the newest slab. **/
+    struct bs_tree_slab *slabs;  /**< The newest slab, linked to the older ones. **/
+    struct node *free_nodes;     /**< Removed nodes, linked through their right child. **/
+} BSTreeArena;
+
+/**
+ * @brief One version of a persistent (immutable) binary search tree.
+ *
+ * Updates copy only the O(log n) nodes on the path to the changed value and
+ * return a new version; all other nodes are shared with the old version,
+ * which stays valid and unchanged. Nodes are reference counted, so they are
+ * freed when the last version using them is released. NULL is the empty tree.
+ *
+ * Versions are never changed, so any number of threads may read them while
+ * others create new versions from them.
+ */
+typedef struct bs_tree_version BSTreeVersion;
+
+/**
+ * @brief Ordered set of values shared by concurrent readers and writers.
+ *
+ * The set holds a current persistent version. Writers build a new version by
+ * path copying and publish it with one atomic store, so readers never take a
+ * lock, never retry and never see a half-done update. Replaced versions are
+ * released once no registered reader can still be reading them.
+ */
+typedef struct bs_tree_concurrent BSTreeConcurrent;
+
+/**
+ * @brief Immutable copy of a binary search tree laid out for fast searching.
+ *
+ * The values are stored in Eytzinger (breadth-first) order: the children of
+ * keys[k] are keys[2k] and keys[2k + 1]. The top levels of the tree share a
+ * few cache lines, and the next levels can be prefetched while the current
+ * one is compared, so a search costs far fewer cache misses than following
+ * child pointers.
+ */
+typedef struct bs_tree_frozen {
+    int n;                  /**< Number of values. **/
+    int *keys;              /**< Array of n + 1 values in Eytzinger order, starting at index 1. **/
+    void *mapping;          /**< Memory-mapped file holding the keys, or NULL if they are allocated. **/
+    size_t mapping_size;    /**< Size of the mapping in bytes. **/
+} BSTreeFrozen;
+
 /**
  * @brief Creates a binary search tree node with a given value.
  *
@@ -117,9 +202,429 @@ BSTreePos bs_tree_left_child(BSTreePos pos);
  */
 BSTreePos bs_tree_right_child(BSTreePos pos);
 
+/**
+ * @brief Inserts a value at its ordered position and rebalances the tree.
+ *
+ * The tree is kept AVL-balanced, so its height stays below 1.44 log2(n + 2).
+ * Values already in the tree are not inserted again. The root may change, so
+ * the returned tree must be used instead of the old one.
+ *
+ * The keyed functions keep the height and size of every node up to date. They must
+ * only be used on trees built by them, not on trees shaped with
+ * bs_tree_insert_left and bs_tree_insert_right.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @param value The value to insert.
+ * @return The root of the resulting tree. On allocation failure the tree is
+ * returned unchanged.
+ */
+BSTree *bs_tree_insert(BSTree *tree, int value);
+
+/**
+ * @brief Searches the tree for a value.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @param value The value to search for.
+ * @return The position of the value, or NULL if it is not in the tree.
+ */
+BSTreePos bs_tree_find(BSTree *tree, int value);
+
+/**
+ * @brief Removes a value from the tree and rebalances the tree.
+ *
+ * The root may change, so the returned tree must be used instead of the old one.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @param value The value to remove.
+ * @return The root of the resulting tree, or NULL if it became empty.
+ */
+BSTree *bs_tree_delete(BSTree *tree, int value);
+
+/**
+ * @brief Returns the height of the tree.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @return The number of nodes on the longest path from the root to a leaf.
+ */
+int bs_tree_height(BSTree *tree);
+
+/**
+ * @brief Returns the number of values in the tree.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @return The number of values.
+ */
+int bs_tree_size(BSTree *tree);
+
+/**
+ * @brief Counts the values in the tree that are smaller than a value.
+ *
+ * Takes O(log n) time using the subtree sizes.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @param value The value to compare with, which need not be in the tree.
+ * @return The number of smaller values, which is the 0-based rank of value if it is in the tree.
+ */
+int bs_tree_rank(BSTree *tree, int value);
+
+/**
+ * @brief Finds the k-th smallest value in the tree.
+ *
+ * Takes O(log n) time using the subtree sizes.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @param k The 0-based rank of the value.
+ * @return The position of the value, or NULL if k is not in [0, size).
+ */
+BSTreePos bs_tree_select(BSTree *tree, int k);
+
+/**
+ * @brief Counts the values in the tree that lie in the closed range [lo, hi].
+ *
+ * Takes O(log n) time using the subtree sizes.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @param lo The smallest value to count.
+ * @param hi The largest value to count.
+ * @return The number of values in the range, 0 if lo > hi.
+ */
+int bs_tree_count_range(BSTree *tree, int lo, int hi);
+
+/**
+ * @brief Starts an in-order iteration over the values in [lo, hi].
+ *
+ * Takes O(log n) time. Every call to bs_tree_range_next then takes O(1)
+ * amortized time.
+ *
+ * @param iter The iterator to initialize.
+ * @param tree The tree, built by the keyed functions, or NULL for an empty tree.
+ * @param lo The smallest value to visit.
+ * @param hi The largest value to visit.
+ */
+void bs_tree_range_begin(BSTreeIter *iter, BSTree *tree, int lo, int hi);
+
+/**
+ * @brief Advances a range iteration.
+ *
+ * @param iter The iterator.
+ * @return The position of the next value in the range, or NULL when the
+ * iteration is done.
+ */
+BSTreePos bs_tree_range_next(BSTreeIter *iter);
+
+/**
+ * @brief Creates an arena for tree nodes.
+ *
+ * @param slab_capacity The number of nodes per slab, or 0 for a default.
+ * @return A pointer to the new arena, or NULL on allocation failure.
+ */
+BSTreeArena *bs_tree_arena_create(int slab_capacity);
+
+/**
+ * @brief Creates a single-node tree in an arena.
+ *
+ * @param arena The arena to allocate the node from.
+ * @param value The value to store in the node.
+ * @return A pointer to the new node, or NULL on allocation failure.
+ */
+BSTree *bs_tree_arena_make(BSTreeArena *arena, int value);
+
+/**
+ * @brief Works like bs_tree_insert, but allocates the node from an arena.
+ *
+ * @param arena The arena the tree was built in.
+ * @param tree The tree, or NULL for an empty tree.
+ * @param value The value to insert.
+ * @return The root of the resulting tree.
+ */
+BSTree *bs_tree_arena_insert(BSTreeArena *arena, BSTree *tree, int value);
+
+/**
+ * @brief Works like bs_tree_delete, but keeps the removed node in the arena for reuse.
+ *
+ * @param arena The arena the tree was built in.
+ * @param tree The tree, or NULL for an empty tree.
+ * @param value The value to remove.
+ * @return The root of the resulting tree, or NULL if it became empty.
+ */
+BSTree *bs_tree_arena_delete(BSTreeArena *arena, BSTree *tree, int value);
+
+/**
+ * @brief Destroys an arena and every tree built in it.
+ *
+ * Takes time proportional to the number of slabs, not the number of nodes.
+ * bs_tree_destroy must not be called on trees built in an arena.
+ *
+ * @param arena The arena to destroy.
+ */
+void bs_tree_arena_destroy(BSTreeArena *arena);
+
+/**
+ * @brief Builds a perfectly balanced tree from sorted values in O(n) time.
+ *
+ * All nodes are placed in a single slab of the arena, in preorder, so a
+ * search walks mostly forward through memory. The tree can afterwards be
+ * changed with bs_tree_arena_insert and bs_tree_arena_delete, and is freed
+ * with the arena.
+ *
+ * @param arena The arena to build the tree in.
+ * @param vals The values, which must be strictly increasing.
+ * @param n The number of values.
+ * @return The root of the tree, or NULL if n is 0 or on failure.
+ */
+BSTree *bs_tree_from_sorted(BSTreeArena *arena, const int *vals, size_t n);
+
+/**
+ * @brief Works like bs_tree_from_sorted, but builds the subtrees in parallel.
+ *
+ * Large subtrees are built as separate tasks when the module is compiled
+ * with OpenMP. Otherwise, this is the same as bs_tree_from_sorted.
+ *
+ * @param arena The arena to build the tree in.
+ * @param vals The values, which must be strictly increasing.
+ * @param n The number of values.
+ * @return The root of the tree, or NULL if n is 0 or on failure.
+ */
+BSTree *bs_tree_from_sorted_parallel(BSTreeArena *arena, const int *vals, size_t n);
+
+/**
+ * @brief Creates a new version of a persistent tree with a value inserted.
+ *
+ * The tree is kept AVL-balanced. The given version is not changed and must
+ * still be released by the caller.
+ *
+ * @param version The version to start from, or NULL for an empty tree.
+ * @param value The value to insert.
+ * @return The new version. On allocation failure, a new reference to the
+ * given version.
+ */
+BSTreeVersion *bs_tree_version_insert(BSTreeVersion *version, int value);
+
+/**
+ * @brief Creates a new version of a persistent tree with a value removed.
+ *
+ * The given version is not changed and must still be released by the caller.
+ *
+ * @param version The version to start from, or NULL for an empty tree.
+ * @param value The value to remove.
+ * @return The new version, or NULL if it is empty. If the value is not in
+ * the tree, or on allocation failure, a new reference to the given version.
+ */
+BSTreeVersion *bs_tree_version_delete(BSTreeVersion *version, int value);
+
+/**
+ * @brief Checks if a version of a persistent tree contains a value.
+ *
+ * @param version The version, or NULL for an empty tree.
+ * @param value The value to search for.
+ * @return true if the value is in the tree, false otherwise.
+ */
+bool bs_tree_version_contains(const BSTreeVersion *version, int value);
+
+/**
+ * @brief Finds the k-th smallest value in a version of a persistent tree.
+ *
+ * @param version The version, or NULL for an empty tree.
+ * @param k The 0-based rank of the value.
+ * @param result Output for the value, may be NULL.
+ * @return true if k is in [0, size), false otherwise.
+ */
+bool bs_tree_version_select(const BSTreeVersion *version, int k, int *result);
+
+/**
+ * @brief Returns the number of values in a version of a persistent tree.
+ *
+ * @param version The version, or NULL for an empty tree.
+ * @return The number of values.
+ */
+int bs_tree_version_size(const BSTreeVersion *version);
+
+/**
+ * @brief Takes a snapshot of a version of a persistent tree in O(1) time.
+ *
+ * The snapshot is a new reference to the same version, and must be released
+ * separately.
+ *
+ * @param version The version, or NULL for an empty tree.
+ * @return The snapshot.
+ */
+BSTreeVersion *bs_tree_version_snapshot(BSTreeVersion *version);
+
+/**
+ * @brief Releases a version of a persistent tree.
+ *
+ * Nodes that no other version shares are freed.
+ *
+ * @param version The version, or NULL for an empty tree.
+ */
+void bs_tree_version_release(BSTreeVersion *version);
+
+/**
+ * @brief Creates an empty concurrent tree.
+ *
+ * @param max_readers The maximum number of registered readers.
+ * @return A pointer to the new tree, or NULL on failure.
+ */
+BSTreeConcurrent *bs_tree_concurrent_create(int max_readers);
+
+/**
+ * @brief Registers a reader thread.
+ *
+ * @param tree The concurrent tree.
+ * @return The reader's slot, to be passed to the read functions, or -1 if
+ * all slots are taken.
+ */
+int bs_tree_concurrent_reader_register(BSTreeConcurrent *tree);
+
+/**
+ * @brief Releases the slot of a reader that is not reading.
+ *
+ * @param tree The concurrent tree.
+ * @param slot The slot returned by bs_tree_concurrent_reader_register.
+ */
+void bs_tree_concurrent_reader_unregister(BSTreeConcurrent *tree, int slot);
+
+/**
+ * @brief Starts reading the current version.
+ *
+ * The returned version can be searched with the bs_tree_version functions
+ * and stays valid and unchanged until bs_tree_concurrent_read_end is called
+ * with the same slot. No locks are taken.
+ *
+ * @param tree The concurrent tree.
+ * @param slot The slot of the reader.
+ * @return The current version, or NULL if it is empty or on failure.
+ */
+const BSTreeVersion *bs_tree_concurrent_read_begin(BSTreeConcurrent *tree, int slot);
+
+/**
+ * @brief Stops reading the version returned by bs_tree_concurrent_read_begin.
+ *
+ * @param tree The concurrent tree.
+ * @param slot The slot of the reader.
+ */
+void bs_tree_concurrent_read_end(BSTreeConcurrent *tree, int slot);
+
+/**
+ * @brief Checks if the current version contains a value, without locking.
+ *
+ * @param tree The concurrent tree.
+ * @param slot The slot of the reader.
+ * @param value The value to search for.
+ * @return true if the value is in the tree, false otherwise.
+ */
+bool bs_tree_concurrent_contains(BSTreeConcurrent *tree, int slot, int value);
+
+/**
+ * @brief Inserts a value and publishes the result as a new version.
+ *
+ * Concurrent writers are serialized with a spin lock. No version is
+ * published if the value is already in the tree.
+ *
+ * @param tree The concurrent tree.
+ * @param value The value to insert.
+ * @return true on success, false on failure, in which case the tree is unchanged.
+ */
+bool bs_tree_concurrent_insert(BSTreeConcurrent *tree, int value);
+
+/**
+ * @brief Removes a value and publishes the result as a new version.
+ *
+ * Concurrent writers are serialized with a spin lock. No version is
+ * published if the value is not in the tree.
+ *
+ * @param tree The concurrent tree.
+ * @param value The value to remove.
+ * @return true on success, false on failure, in which case the tree is unchanged.
+ */
+bool bs_tree_concurrent_delete(BSTreeConcurrent *tree, int value);
+
+/**
+ * @brief Returns the number of published versions.
+ *
+ * @param tree The concurrent tree.
+ * @return The number of the current version, starting at 0.
+ */
+long long bs_tree_concurrent_version(BSTreeConcurrent *tree);
+
+/**
+ * @brief Destroys the concurrent tree and all its versions.
+ *
+ * No reader may be reading when it is destroyed.
+ *
+ * @param tree The concurrent tree to destroy.
+ */
+void bs_tree_concurrent_destroy(BSTreeConcurrent *tree);
+
+/**
+ * @brief Creates an immutable, search-optimized copy of a binary search tree.
+ *
+ * The tree is traversed in order without recursion or extra memory, by
+ * temporarily threading it (Morris traversal); it is unchanged afterwards.
+ * The values must be strictly increasing in order.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @return A pointer to the frozen copy, or NULL if the tree is not ordered or
+ * on allocation failure.
+ */
+BSTreeFrozen *bs_tree_freeze(BSTree *tree);
+
+/**
+ * @brief Finds the smallest value that is greater than or equal to a value.
+ *
+ * The search has no data-dependent branches, and prefetches the keys four
+ * levels ahead.
+ *
+ * @param frozen The frozen tree.
+ * @param value The value to search for.
+ * @param result Output for the value found, may be NULL.
+ * @return true if such a value exists, false otherwise.
+ */
+bool bs_tree_frozen_lower_bound(const BSTreeFrozen *frozen, int value, int *result);
+
+/**
+ * @brief Saves the values of a tree to a binary file.
+ *
+ * The file holds a versioned header with a checksum, followed by the keys of
+ * a frozen copy of the tree in native byte order. The layout has no
+ * pointers: the children of the key at index k are at 2k and 2k + 1. It is
+ * written to a temporary file that is renamed over path when complete, so
+ * an existing file is never left half-written.
+ *
+ * @param tree The tree, or NULL for an empty tree.
+ * @param path The path of the file.
+ * @return true on success, false if the tree is not ordered or on failure.
+ */
+bool bs_tree_save(BSTree *tree, const char *path);
+
+/**
+ * @brief Opens a file written by bs_tree_save as a frozen tree.
+ *
+ * The file is memory-mapped and searched in place with
+ * bs_tree_frozen_lower_bound, so loading takes constant time, no nodes are
+ * allocated, and pages are only read when searches reach them. Checking the
+ * checksum reads the whole file and is optional. The mapping is released by
+ * bs_tree_frozen_destroy.
+ *
+ * @param path The path of the file.
+ * @param verify true to check the checksum of the keys.
+ * @return A pointer to the frozen tree, or NULL on failure.
+ */
+BSTreeFrozen *bs_tree_load(const char *path, bool verify);
+
+/**
+ * @brief Destroys a frozen tree, freeing all allocated resources.
+ *
+ * @param frozen The frozen tree to destroy.
+ */
+void bs_tree_frozen_destroy(BSTreeFrozen *frozen);
+
 /**
  * @brief Destroys the binary search tree, freeing all allocated resources.
  *
+ * The nodes are freed without recursion, by rotating left children up until
+ * the root has none, so even degenerate trees of any depth can be destroyed.
+ *
  * @param tree The binary search tree to destroy.
  */
 void bs_tree_destroy(BSTree *tree);
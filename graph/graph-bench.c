@@ -0,0 +1,257 @@
+/*
+ * File:         graph-bench.c
+ * Description:  Benchmarks of the graph module.
+ *
+ *               Build with optimizations, for example:
+ *               gcc -O2 -I../set graph-bench.c graph.c ../set/set.c -lm
+ *
+ * Author:       Emil Engvall
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "graph.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+double now(void);
+Graph *make_shuffled_grid(int side);
+Graph *make_random_graph(int n, int degree);
+double bench_bfs(GraphCSR *csr, int rounds);
+double bench_pagerank(Graph *g, int iterations);
+void bench_reorder(int side);
+void bench_msbfs(int n, int k);
+void bench_load_edgelist(int n, int m);
+
+
+int main(void)
+{
+    srand(1);
+    bench_reorder(300);
+    bench_msbfs(30000, 256);
+    bench_load_edgelist(20000, 20000000);
+    return 0;
+}
+
+// Returns a monotonic time in seconds.
+double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Creates a side x side grid with randomly shuffled node labels, which gives
+// the poor locality of real-world graphs loaded in arbitrary order.
+Graph *make_shuffled_grid(int side)
+{
+    int n = side * side;
+    int *label = malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        label[i] = i;
+    }
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int tmp = label[i];
+        label[i] = label[j];
+        label[j] = tmp;
+    }
+
+    Graph *g = graph_create(n);
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++) {
+            int v = label[r * side + c];
+            if (c + 1 < side) {
+                graph_insert_edge(g, v, label[r * side + c + 1]);
+                graph_insert_edge(g, label[r * side + c + 1], v);
+            }
+            if (r + 1 < side) {
+                graph_insert_edge(g, v, label[(r + 1) * side + c]);
+                graph_insert_edge(g, label[(r + 1) * side + c], v);
+            }
+        }
+    }
+
+    free(label);
+    return g;
+}
+
+// Creates a graph where every node has edges to degree random nodes.
+Graph *make_random_graph(int n, int degree)
+{
+    Graph *g = graph_create(n);
+    for (int v = 0; v < n; v++) {
+        for (int i = 0; i < degree; i++) {
+            graph_insert_edge(g, v, rand() % n);
+        }
+    }
+    return g;
+}
+
+// Runs a breadth-first search from every node in turn and returns the time per search.
+double bench_bfs(GraphCSR *csr, int rounds)
+{
+    int *dist = malloc(csr->n * sizeof(int));
+    int *queue = malloc(csr->n * sizeof(int));
+    long long checksum = 0;
+
+    double start = now();
+    for (int r = 0; r < rounds; r++) {
+        int src = (int)((long long)r * 7919 % csr->n);
+        for (int i = 0; i < csr->n; i++) {
+            dist[i] = -1;
+        }
+        int head = 0;
+        int tail = 0;
+        dist[src] = 0;
+        queue[tail++] = src;
+        while (head < tail) {
+            int v = queue[head++];
+            for (int e = csr->offsets[v]; e < csr->offsets[v + 1]; e++) {
+                int w = csr->targets[e];
+                if (dist[w] == -1) {
+                    dist[w] = dist[v] + 1;
+                    queue[tail++] = w;
+                }
+            }
+        }
+        checksum += dist[csr->n - 1];
+    }
+    double elapsed = (now() - start) / rounds;
+
+    if (checksum == -1) {
+        printf("unreachable\n");
+    }
+    free(dist);
+    free(queue);
+    return elapsed;
+}
+
+// Runs a fixed number of PageRank iterations and returns the time per iteration.
+double bench_pagerank(Graph *g, int iterations)
+{
+    PageRank *pr = graph_pagerank_create(g, 0.85, NULL);
+    double start = now();
+    graph_pagerank_run(pr, 0.0, iterations);
+    double elapsed = (now() - start) / iterations;
+    graph_pagerank_destroy(pr);
+    return elapsed;
+}
+
+// Compares BFS and PageRank before and after reordering a shuffled grid.
+void bench_reorder(int side)
+{
+    const char *names[] = {"shuffled", "degree", "rcm", "gorder"};
+    GraphOrder orders[] = {GRAPH_ORDER_DEGREE, GRAPH_ORDER_RCM, GRAPH_ORDER_GORDER};
+
+    printf("graph_reorder on a shuffled %dx%d grid\n", side, side);
+    printf("%-10s %12s %14s %16s\n", "order", "reorder (s)", "bfs (ms/run)", "pagerank (ms/it)");
+
+    for (int k = 0; k < 4; k++) {
+        srand(1);
+        Graph *g = make_shuffled_grid(side);
+
+        double reorder_time = 0.0;
+        if (k > 0) {
+            double start = now();
+            graph_reorder(g, orders[k - 1], NULL);
+            reorder_time = now() - start;
+        }
+
+        GraphCSR *csr = graph_csr_create(g);
+        double bfs = bench_bfs(csr, 50);
+        double pagerank = bench_pagerank(g, 50);
+        printf("%-10s %12.3f %14.3f %16.3f\n", names[k], reorder_time, bfs * 1e3, pagerank * 1e3);
+
+        graph_csr_destroy(csr);
+        graph_destroy(g);
+    }
+}
+
+// Compares graph_msbfs with k independent breadth-first searches.
+void bench_msbfs(int n, int k)
+{
+    srand(1);
+    Graph *g = make_random_graph(n, 8);
+    double start = now();
+    GraphCSR *csr = graph_csr_create(g);
+    double setup = now() - start;
+    int *sources = malloc(k * sizeof(int));
+    int *dist = malloc((size_t)k * n * sizeof(int));
+    for (int i = 0; i < k; i++) {
+        sources[i] = (int)((long long)i * 7919 % n);
+    }
+
+    double single = bench_bfs(csr, k) * k + setup;
+
+    start = now();
+    graph_msbfs(g, sources, k, dist);
+    double batched = now() - start;
+
+    printf("\ngraph_msbfs on a random graph with %d nodes and degree 8, %d sources\n", n, k);
+    printf("%-14s %10s %12s\n", "method", "time (s)", "bfs/s");
+    printf("%-14s %10.3f %12.0f\n", "independent", single, k / single);
+    printf("%-14s %10.3f %12.0f\n", "graph_msbfs", batched, k / batched);
+    printf("(both include %.3f s for copying the edges out of the sets once)\n", setup);
+
+    free(sources);
+    free(dist);
+    graph_csr_destroy(csr);
+    graph_destroy(g);
+}
+
+// Compares loading m random edges between n nodes from a text and a binary
+// file with graph_load_edgelist, and inserting them with graph_insert_edge.
+void bench_load_edgelist(int n, int m)
+{
+    const char *path = "graph-bench.tmp";
+    int *edges = malloc(2 * (size_t)m * sizeof(int));
+    srand(1);
+    for (size_t i = 0; i < 2 * (size_t)m; i++) {
+        edges[i] = rand() % n;
+    }
+    // Make sure the largest node is used, so every method makes n nodes
+    edges[0] = n - 1;
+
+    printf("\ngraph_load_edgelist with %d random edges between %d nodes\n", m, n);
+    printf("%-18s %10s %14s\n", "method", "time (s)", "Medges/s");
+
+    double start = now();
+    Graph *g = graph_create(n);
+    for (int i = 0; i < m; i++) {
+        graph_insert_edge(g, edges[2 * i], edges[2 * i + 1]);
+    }
+    double elapsed = now() - start;
+    graph_destroy(g);
+    printf("%-18s %10.3f %14.1f\n", "graph_insert_edge", elapsed, m / elapsed * 1e-6);
+
+    const char *names[] = {"text", "binary"};
+    GraphFormat formats[] = {GRAPH_FORMAT_TEXT, GRAPH_FORMAT_BINARY};
+    for (int k = 0; k < 2; k++) {
+        FILE *fp = fopen(path, "wb");
+        if (fp == NULL) {
+            perror("Error in bench_load_edgelist: Could not create file");
+            break;
+        }
+        if (formats[k] == GRAPH_FORMAT_TEXT) {
+            for (int i = 0; i < m; i++) {
+                fprintf(fp, "%d %d\n", edges[2 * i], edges[2 * i + 1]);
+            }
+        } else {
+            fwrite(edges, sizeof(int), 2 * (size_t)m, fp);
+        }
+        long size = ftell(fp);
+        fclose(fp);
+
+        start = now();
+        g = graph_load_edgelist(path, formats[k]);
+        elapsed = now() - start;
+        printf("%-18s %10.3f %14.1f   (%.0f MB file)\n", names[k], elapsed, m / elapsed * 1e-6, size / 1e6);
+        graph_destroy(g);
+    }
+
+    remove(path);
+    free(edges);
+}
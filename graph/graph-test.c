@@ -14,11 +14,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <math.h>
+#include <stdint.h>
 
 
-void depth_first(int n, Graph *g, int visited[]);
+void print_node(int node, void *ctx);
 void add_random_edges(Graph *g, int num_edges);
 void print_neighbours(Graph *g);
+void print_test_result(int condition, const char *test_name);
+void test_components(void);
+void test_triangles(void);
+void test_pagerank(void);
+void test_load_edgelist(void);
+void test_reorder(void);
+void test_reachability(void);
+void test_msbfs(void);
+void test_save_open(void);
+void test_versioned(void);
+void test_degrees_and_kcore(void);
+void test_dfs(void);
+void record_node(int node, void *ctx);
 
 int main() 
 {
@@ -32,13 +47,8 @@ int main()
     add_random_edges(g, 15); 
 
     // Utför en djupet-först traversering från nod 0
-    int visited[nr_nodes];
-    for (int i = 0; i < nr_nodes; i++) {
-        visited[i] = 0;
-    }
-
     printf("DFS traversering från nod 0:\n");
-    depth_first(0, g, visited);
+    graph_dfs(g, 0, print_node, NULL, NULL);
     printf("\n");
 
     // Skriver ut grannskapslistorna
@@ -48,31 +58,70 @@ int main()
     // Förstör grafen
     graph_destroy(g);
 
+    test_components();
+    test_triangles();
+    test_pagerank();
+    test_load_edgelist();
+    test_reorder();
+    test_reachability();
+    test_msbfs();
+    test_save_open();
+    test_versioned();
+    test_degrees_and_kcore();
+    test_dfs();
+
     return 0;
 }
 
-void depth_first(int n, Graph *g, int visited[]) 
+void print_test_result(int condition, const char *test_name) 
 {
-    // visit(n) - Mark the node n as visited
-    printf("%d ", n);
-    visited[n] = 1;
+    if (condition) {
+        printf("PASS: %s\n", test_name);
+    } else {
+        printf("FAIL: %s\n", test_name);
+    }
+}
 
-    // neighbourSet = neighbours(n, g)
-    set *neighbourSet = graph_neighbours(g, n);
-    if (neighbourSet != NULL) {
-        int *neighbourValues = set_get_values(neighbourSet);
+void test_components(void) 
+{
+    // 0 -> 1 -> 2 -> 0 forms a cycle, 3 -> 4 is a chain and 5 is isolated
+    Graph *g = graph_create(6);
+    graph_insert_edge(g, 0, 1);
+    graph_insert_edge(g, 1, 2);
+    graph_insert_edge(g, 2, 0);
+    graph_insert_edge(g, 3, 4);
 
-        // for each node v in g
-        for (int v = 0; v < graph_no_of_nodes(g); v++) {
-            // if v is a member of neighbourSet and not visited
-            if (set_member_of(v, neighbourSet) && !visited[v]) {
-                // depthFirst(v, g)
-                depth_first(v, g, visited);
-            }
-        }
+    int k;
+    int *wcc = graph_weakly_connected_components(g, &k);
+    int condition = k == 3 && wcc[0] == 0 && wcc[1] == 0 && wcc[2] == 0
+                    && wcc[3] == 1 && wcc[4] == 1 && wcc[5] == 2;
+    print_test_result(condition, "graph_weakly_connected_components");
+    free(wcc);
+
+    int *scc = graph_strongly_connected_components(g, &k);
+    condition = k == 4 && scc[0] == scc[1] && scc[1] == scc[2]
+                && scc[3] != scc[4] && scc[4] < scc[3];
+    print_test_result(condition, "graph_strongly_connected_components");
+    free(scc);
+    graph_destroy(g);
 
-        free(neighbourValues);
+    // A long cycle makes a recursive DFS go deep. The adjacency bitsets of
+    // a cycle take about n^2 / 16 bytes, 156 MB here.
+    int n = 50000;
+    g = graph_create(n);
+    for (int i = 0; i < n; i++) {
+        graph_insert_edge(g, i, (i + 1) % n);
     }
+    scc = graph_strongly_connected_components(g, &k);
+    print_test_result(scc != NULL && k == 1, "graph_strongly_connected_components (long cycle)");
+    free(scc);
+    graph_destroy(g);
+}
+
+void print_node(int node, void *ctx) 
+{
+    (void)ctx;
+    printf("%d ", node);
 }
 
 void add_random_edges(Graph *g, int num_edges) {
@@ -107,3 +156,423 @@ void print_neighbours(Graph *g)
         printf("\n");
     }
 }
+
+void test_triangles(void) 
+{
+    // Two triangles 0-1-2 and 1-2-3 sharing the edge 1-2, plus a tail 3-4
+    Graph *g = graph_create(5);
+    graph_insert_edge(g, 0, 1);
+    graph_insert_edge(g, 1, 2);
+    graph_insert_edge(g, 2, 0);
+    graph_insert_edge(g, 1, 3);
+    graph_insert_edge(g, 3, 2);
+    graph_insert_edge(g, 2, 1);
+    graph_insert_edge(g, 3, 4);
+
+    print_test_result(graph_triangle_count(g) == 2, "graph_triangle_count");
+
+    double *c = graph_local_clustering(g);
+    int condition = c[0] == 1.0 && c[1] > 0.66 && c[1] < 0.67
+                    && c[3] > 0.33 && c[3] < 0.34 && c[4] == 0.0;
+    print_test_result(condition, "graph_local_clustering");
+    free(c);
+    graph_destroy(g);
+}
+
+void test_pagerank(void) 
+{
+    int n = 50;
+    Graph *g = graph_create(n);
+    for (int i = 0; i < n; i++) {
+        graph_insert_edge(g, i, (i + 1) % n);
+        graph_insert_edge(g, i, (i * 7) % n);
+    }
+
+    PageRank *pr = graph_pagerank_create(g, 0.85, NULL);
+    graph_pagerank_run(pr, 1e-10, 1000);
+
+    double total = 0.0;
+    for (int i = 0; i < n; i++) {
+        total += graph_pagerank_scores(pr)[i];
+    }
+    print_test_result(fabs(total - 1.0) < 1e-9, "graph_pagerank_run");
+
+    // Change the graph and compare the incremental update with a full run
+    int changed[] = {3, 10};
+    graph_insert_edge(g, 3, 40);
+    graph_remove_edge(g, 10, 11);
+    graph_pagerank_update(pr, g, changed, 2, 1e-10);
+
+    PageRank *full = graph_pagerank_create(g, 0.85, NULL);
+    graph_pagerank_run(full, 1e-10, 1000);
+
+    double diff = 0.0;
+    for (int i = 0; i < n; i++) {
+        diff += fabs(graph_pagerank_scores(pr)[i] - graph_pagerank_scores(full)[i]);
+    }
+    print_test_result(diff < 1e-6, "graph_pagerank_update");
+
+    graph_pagerank_destroy(pr);
+    graph_pagerank_destroy(full);
+    graph_destroy(g);
+}
+
+void test_load_edgelist(void) 
+{
+    const char *path = "graph-test-edges.tmp";
+
+    FILE *fp = fopen(path, "w");
+    fputs("# a comment\n0 1\n1\t2 0.5\n\n% another comment\n2 0\n2 12\n", fp);
+    fclose(fp);
+
+    Graph *g = graph_load_edgelist(path, GRAPH_FORMAT_TEXT);
+    int condition = g != NULL && graph_no_of_nodes(g) == 13
+                    && set_member_of(1, graph_neighbours(g, 0))
+                    && set_member_of(2, graph_neighbours(g, 1))
+                    && set_member_of(12, graph_neighbours(g, 2))
+                    && set_size(graph_neighbours(g, 2)) == 2;
+    print_test_result(condition, "graph_load_edgelist (text)");
+    if (g != NULL) {
+        graph_destroy(g);
+    }
+
+    int pairs[] = {0, 3, 3, 1, 1, 0};
+    fp = fopen(path, "wb");
+    fwrite(pairs, sizeof(int), 6, fp);
+    fclose(fp);
+
+    g = graph_load_edgelist(path, GRAPH_FORMAT_BINARY);
+    condition = g != NULL && graph_no_of_nodes(g) == 4
+                && set_member_of(3, graph_neighbours(g, 0))
+                && set_member_of(1, graph_neighbours(g, 3))
+                && set_member_of(0, graph_neighbours(g, 1));
+    print_test_result(condition, "graph_load_edgelist (binary)");
+    if (g != NULL) {
+        graph_destroy(g);
+    }
+
+    // INT32_MAX would overflow the node count, so it is rejected
+    int32_t too_large[] = {0, 1, INT32_MAX, 0};
+    fp = fopen(path, "wb");
+    fwrite(too_large, sizeof(int32_t), 4, fp);
+    fclose(fp);
+
+    g = graph_load_edgelist(path, GRAPH_FORMAT_BINARY);
+    print_test_result(g == NULL, "graph_load_edgelist (binary, node index too large)");
+    if (g != NULL) {
+        graph_destroy(g);
+    }
+
+    remove(path);
+}
+
+void test_reorder(void) 
+{
+    const char *names[] = {"graph_reorder (degree)", "graph_reorder (rcm)", "graph_reorder (gorder)"};
+    GraphOrder orders[] = {GRAPH_ORDER_DEGREE, GRAPH_ORDER_RCM, GRAPH_ORDER_GORDER};
+    int n = 300;
+
+    for (int k = 0; k < 3; k++) {
+        Graph *original = graph_create(n);
+        Graph *g = graph_create(n);
+        for (int i = 0; i < 2 * n; i++) {
+            int a = (i * 37) % n;
+            int b = (i * 101 + 7) % n;
+            graph_insert_edge(original, a, b);
+            graph_insert_edge(g, a, b);
+        }
+
+        int perm[n];
+        int seen[n];
+        int condition = graph_reorder(g, orders[k], perm);
+        for (int i = 0; i < n; i++) {
+            seen[i] = 0;
+        }
+        for (int i = 0; condition && i < n; i++) {
+            condition = perm[i] >= 0 && perm[i] < n && !seen[perm[i]];
+            seen[perm[i]] = 1;
+        }
+
+        // Every edge a -> b must now be perm[a] -> perm[b]
+        for (int a = 0; condition && a < n; a++) {
+            set *old_nb = graph_neighbours(original, a);
+            set *new_nb = graph_neighbours(g, perm[a]);
+            condition = set_size(old_nb) == set_size(new_nb);
+            for (int b = 0; condition && b < n; b++) {
+                condition = set_member_of(b, old_nb) == set_member_of(perm[b], new_nb);
+            }
+        }
+        print_test_result(condition, names[k]);
+
+        graph_destroy(original);
+        graph_destroy(g);
+    }
+}
+
+void test_reachability(void) 
+{
+    int n = 120;
+    Graph *g = graph_create(n);
+    // Mostly forward edges, with a few short cycles
+    for (int i = 0; i < n; i++) {
+        if ((i * 13 + 5) % n > i) {
+            graph_insert_edge(g, i, (i * 13 + 5) % n);
+        }
+        if (i % 4 == 0 && i + 1 < n) {
+            graph_insert_edge(g, i, i + 1);
+        }
+        if (i % 10 == 1) {
+            graph_insert_edge(g, i, i - 1);
+        }
+    }
+
+    // Compute the expected answers with a plain traversal from every node
+    int reach[n][n];
+    for (int a = 0; a < n; a++) {
+        int stack[n];
+        int top = 0;
+        for (int b = 0; b < n; b++) {
+            reach[a][b] = 0;
+        }
+        reach[a][a] = 1;
+        stack[top++] = a;
+        while (top > 0) {
+            int v = stack[--top];
+            for (int w = 0; w < n; w++) {
+                if (set_member_of(w, graph_neighbours(g, v)) && !reach[a][w]) {
+                    reach[a][w] = 1;
+                    stack[top++] = w;
+                }
+            }
+        }
+    }
+
+    ReachabilityIndex *closure = graph_reachability_index(g, 0);
+    ReachabilityIndex *labels = graph_reachability_index(g, 2);
+    int closure_ok = closure != NULL;
+    int labels_ok = labels != NULL;
+    for (int a = 0; a < n; a++) {
+        for (int b = 0; b < n; b++) {
+            closure_ok = closure_ok && graph_reachable(closure, a, b) == reach[a][b];
+            labels_ok = labels_ok && graph_reachable(labels, a, b) == reach[a][b];
+        }
+    }
+    print_test_result(closure_ok, "graph_reachable (closure)");
+    print_test_result(labels_ok, "graph_reachable (interval labels)");
+
+    graph_reachability_index_destroy(closure);
+    graph_reachability_index_destroy(labels);
+    graph_destroy(g);
+}
+
+void test_msbfs(void) 
+{
+    // More sources than fit in one batch
+    int n = 400;
+    int k = 300;
+    Graph *g = graph_create(n);
+    for (int i = 0; i < n; i++) {
+        graph_insert_edge(g, i, (i + 1) % n);
+        graph_insert_edge(g, i, (i * 17 + 3) % n);
+    }
+
+    int *sources = malloc(k * sizeof(int));
+    int *dist = malloc(k * n * sizeof(int));
+    for (int i = 0; i < k; i++) {
+        sources[i] = (i * 7) % n;
+    }
+
+    int condition = graph_msbfs(g, sources, k, dist);
+
+    // Compare with a plain breadth-first search from every source
+    int expected[n];
+    int queue[n];
+    for (int i = 0; condition && i < k; i++) {
+        for (int v = 0; v < n; v++) {
+            expected[v] = -1;
+        }
+        int head = 0;
+        int tail = 0;
+        expected[sources[i]] = 0;
+        queue[tail++] = sources[i];
+        while (head < tail) {
+            int v = queue[head++];
+            for (int w = 0; w < n; w++) {
+                if (set_member_of(w, graph_neighbours(g, v)) && expected[w] == -1) {
+                    expected[w] = expected[v] + 1;
+                    queue[tail++] = w;
+                }
+            }
+        }
+        for (int v = 0; v < n; v++) {
+            condition = condition && dist[i * n + v] == expected[v];
+        }
+    }
+    print_test_result(condition, "graph_msbfs");
+
+    free(sources);
+    free(dist);
+    graph_destroy(g);
+}
+
+void test_save_open(void) 
+{
+    const char *path = "graph-test-save.tmp";
+    Graph *g = graph_create(5);
+    graph_insert_edge(g, 0, 4);
+    graph_insert_edge(g, 0, 2);
+    graph_insert_edge(g, 3, 1);
+
+    int condition = graph_save(g, path);
+    GraphCSR *csr = graph_open(path, true);
+    condition = condition && csr != NULL && csr->n == 5 && csr->m == 3
+                && csr->offsets[1] == 2 && csr->targets[0] == 2 && csr->targets[1] == 4
+                && csr->offsets[3] == 2 && csr->offsets[4] == 3 && csr->targets[2] == 1;
+    print_test_result(condition, "graph_save and graph_open");
+    if (csr != NULL) {
+        graph_csr_destroy(csr);
+    }
+
+    // Corrupt one target and check that the checksum catches it
+    FILE *fp = fopen(path, "r+b");
+    fseek(fp, -1, SEEK_END);
+    fputc(7, fp);
+    fclose(fp);
+    csr = graph_open(path, true);
+    print_test_result(csr == NULL, "graph_open (corrupt file)");
+    if (csr != NULL) {
+        graph_csr_destroy(csr);
+    }
+
+    remove(path);
+    graph_destroy(g);
+}
+
+void test_versioned(void) 
+{
+    Graph *g = graph_create(4);
+    graph_insert_edge(g, 0, 1);
+    graph_insert_edge(g, 1, 2);
+    VersionedGraph *vg = graph_versioned_create(g, 2);
+    graph_destroy(g);
+
+    int reader = graph_versioned_reader_register(vg);
+    const GraphCSR *before = graph_versioned_read_begin(vg, reader);
+
+    int inserts[] = {0, 3, 2, 0};
+    int removes[] = {1, 2};
+    int condition = graph_versioned_commit(vg, inserts, 2, removes, 1)
+                    && graph_versioned_version(vg) == 1;
+
+    // The reader still sees the old version until it stops reading
+    condition = condition && before->m == 2 && before->targets[0] == 1 && before->targets[1] == 2;
+    graph_versioned_read_end(vg, reader);
+
+    const GraphCSR *after = graph_versioned_read_begin(vg, reader);
+    condition = condition && after->m == 3
+                && after->offsets[1] == 2 && after->targets[0] == 1 && after->targets[1] == 3
+                && after->offsets[2] == 2 && after->offsets[3] == 3 && after->targets[2] == 0;
+    graph_versioned_read_end(vg, reader);
+    print_test_result(condition, "graph_versioned_commit");
+
+    graph_versioned_reader_unregister(vg, reader);
+    graph_versioned_destroy(vg);
+}
+
+void test_degrees_and_kcore(void) 
+{
+    // A 4-clique 0-3 with a triangle 3-4-5 and a tail 5-6 attached
+    Graph *g = graph_create(8);
+    for (int a = 0; a < 4; a++) {
+        for (int b = a + 1; b < 4; b++) {
+            graph_insert_edge(g, a, b);
+        }
+    }
+    graph_insert_edge(g, 3, 4);
+    graph_insert_edge(g, 4, 5);
+    graph_insert_edge(g, 5, 3);
+    graph_insert_edge(g, 5, 6);
+
+    int *out = graph_degrees(g, GRAPH_DEGREE_OUT);
+    int *in = graph_degrees(g, GRAPH_DEGREE_IN);
+    int condition = out[0] == 3 && out[3] == 1 && in[3] == 4 && in[7] == 0;
+    print_test_result(condition, "graph_degrees");
+    free(out);
+    free(in);
+
+    int max_degree;
+    int *histogram = graph_degree_histogram(g, GRAPH_DEGREE_UNDIRECTED, &max_degree);
+    condition = max_degree == 5 && histogram[0] == 1 && histogram[1] == 1
+                && histogram[2] == 1 && histogram[3] == 4 && histogram[5] == 1;
+    print_test_result(condition, "graph_degree_histogram");
+    free(histogram);
+
+    int expected[] = {3, 3, 3, 3, 2, 2, 1, 0};
+    int max_core;
+    int *core = graph_kcore(g, &max_core);
+    condition = max_core == 3;
+    for (int v = 0; v < 8; v++) {
+        condition = condition && core[v] == expected[v];
+    }
+    print_test_result(condition, "graph_kcore");
+    free(core);
+
+    core = graph_kcore_parallel(g, &max_core);
+    condition = max_core == 3;
+    for (int v = 0; v < 8; v++) {
+        condition = condition && core[v] == expected[v];
+    }
+    print_test_result(condition, "graph_kcore_parallel");
+    free(core);
+
+    graph_destroy(g);
+}
+
+void record_node(int node, void *ctx) 
+{
+    int *log = ctx;
+    log[++log[0]] = node;
+}
+
+void test_dfs(void) 
+{
+    // A chain long enough to overflow the stack of a recursive traversal
+    int n = 100000;
+    Graph *g = graph_create(n);
+    for (int i = 0; i + 1 < n; i++) {
+        graph_insert_edge(g, i, i + 1);
+    }
+
+    int *pre = calloc(n + 1, sizeof(int));
+    int *post = calloc(n + 1, sizeof(int));
+    int condition = graph_dfs(g, 0, record_node, NULL, pre)
+                    && graph_dfs(g, 0, NULL, record_node, post)
+                    && pre[0] == n && post[0] == n
+                    && pre[1] == 0 && pre[n] == n - 1 && post[1] == n - 1 && post[n] == 0;
+    print_test_result(condition, "graph_dfs");
+    free(pre);
+    free(post);
+    graph_destroy(g);
+
+    // 3 -> 1 -> 0 and 3 -> 2 -> 0, plus 4 -> 3
+    g = graph_create(5);
+    graph_insert_edge(g, 3, 1);
+    graph_insert_edge(g, 3, 2);
+    graph_insert_edge(g, 1, 0);
+    graph_insert_edge(g, 2, 0);
+    graph_insert_edge(g, 4, 3);
+
+    int *order = graph_topological_sort(g);
+    int position[5];
+    for (int i = 0; order != NULL && i < 5; i++) {
+        position[order[i]] = i;
+    }
+    condition = order != NULL && position[4] < position[3] && position[3] < position[1]
+                && position[3] < position[2] && position[1] < position[0] && position[2] < position[0];
+    free(order);
+
+    graph_insert_edge(g, 0, 4);
+    condition = condition && graph_topological_sort(g) == NULL;
+    print_test_result(condition, "graph_topological_sort");
+    graph_destroy(g);
+}
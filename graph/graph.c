@@ -9,102 +9,2797 @@
  * Date:  2023-12-30
  * 
  */
+#define _POSIX_C_SOURCE 200809L
+
 #include "graph.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Number of 64-bit words per node in graph_msbfs, i.e. 256 searches per pass */
+#define MSBFS_WORDS 4
+
+/* Identification of the files written by graph_save */
+#define GRAPH_FILE_MAGIC "GRAPHCSR"
+#define GRAPH_FILE_VERSION 1
+#define GRAPH_FILE_BYTE_ORDER 0x01020304u
+
+/**
+ * One version of a VersionedGraph.
+ */
+struct graph_version {
+    GraphCSR *csr;                  /* The immutable edges of this version */
+    long long retired;              /* Epoch in which the version was replaced */
+    struct graph_version *next;     /* Next version in the list of replaced versions */
+};
+
+/**
+ * Epoch announced by a registered reader that is not reading.
+ */
+#define READER_IDLE LLONG_MAX
+
+struct VersionedGraph {
+    _Atomic(struct graph_version *) current;  /* Version seen by new readers */
+    atomic_llong epoch;                         /* Number of the current version */
+    int max_readers;                            /* Number of reader slots */
+    atomic_int *registered;                     /* Whether a slot is taken */
+    atomic_llong *announced;                    /* Epoch each reader started in, or READER_IDLE */
+    atomic_flag writer;                         /* Lock serializing the writers */
+    struct graph_version *retired;              /* Replaced versions not yet freed */
+};
+
+/**
+ * Header of the files written by graph_save, followed by n + 1 offsets and m targets.
+ */
+struct graph_file_header {
+    char magic[8];          /* GRAPH_FILE_MAGIC without terminator */
+    uint32_t version;       /* GRAPH_FILE_VERSION */
+    uint32_t byte_order;    /* GRAPH_FILE_BYTE_ORDER as written by the saving machine */
+    int32_t n;              /* Number of nodes */
+    int32_t m;              /* Number of edges */
+    uint64_t checksum;      /* FNV-1a hash of the offsets and targets */
+};
+
+/* ---------------------- Internal functions ---------------------- */
+
+/**
+ * Finds the root of a node in a union-find forest.
+ *
+ * Uses path halving: every visited node is pointed to its grandparent,
+ * which keeps the trees flat without needing recursion. Parents are only
+ * ever smaller nodes and ancestors stay ancestors, so the halving is safe
+ * with plain stores even while other threads link roots.
+ */
+static int uf_find(atomic_int *parent, int x)
+{
+    int p = atomic_load_explicit(&parent[x], memory_order_relaxed);
+    while (p != x) {
+        int grandparent = atomic_load_explicit(&parent[p], memory_order_relaxed);
+        atomic_store_explicit(&parent[x], grandparent, memory_order_relaxed);
+        x = p;
+        p = grandparent;
+    }
+    return x;
+}
+
+/**
+ * Joins the sets of two nodes in a union-find forest.
+ *
+ * The larger root is always linked under the smaller one, so the root of
+ * every set is its smallest node. The link is a compare-and-swap that only
+ * succeeds while the larger root is still a root, and is retried from the
+ * new roots otherwise, so concurrent unions need no lock.
+ */
+static void uf_union(atomic_int *parent, int a, int b)
+{
+    for (;;) {
+        int ra = uf_find(parent, a);
+        int rb = uf_find(parent, b);
+        if (ra == rb) {
+            return;
+        }
+        if (rb < ra) {
+            int tmp = ra;
+            ra = rb;
+            rb = tmp;
+        }
+        int expected = rb;
+        if (atomic_compare_exchange_weak_explicit(&parent[rb], &expected, ra,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            return;
+        }
+        a = ra;
+        b = rb;
+    }
+}
+
+/**
+ * Destroys an array of n sets.
+ */
+static void destroy_sets(set **sets, int n)
+{
+    if (sets != NULL) {
+        for (int i = 0; i < n; i++) {
+            if (sets[i] != NULL) {
+                set_destroy(sets[i]);
+            }
+        }
+        free(sets);
+    }
+}
+
+/**
+ * Builds the undirected neighbourhood of every node, without self-loops.
+ *
+ * If rank is not NULL, only the edges pointing to a node with a higher rank
+ * are kept, which orients every undirected edge exactly once.
+ */
+static set **undirected_neighbours(Graph *g, const long long *rank)
+{
+    set **nb = calloc(g->n > 0 ? g->n : 1, sizeof(set *));
+    if (nb == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < g->n; i++) {
+        nb[i] = set_empty();
+        if (nb[i] == NULL) {
+            destroy_sets(nb, i);
+            return NULL;
+        }
+    }
+
+    for (int a = 0; a < g->n; a++) {
+        for (int b = set_next(0, g->edges[a]); b != -1 && b < g->n; b = set_next(b + 1, g->edges[a])) {
+            if (a == b) {
+                continue;
+            }
+            if (rank == NULL) {
+                set_insert(b, nb[a]);
+                set_insert(a, nb[b]);
+            } else if (rank[a] < rank[b]) {
+                set_insert(b, nb[a]);
+            } else {
+                set_insert(a, nb[b]);
+            }
+        }
+    }
+
+    return nb;
+}
+
+/**
+ * Allocates a GraphCSR with room for n nodes and m edges.
+ */
+static GraphCSR *csr_alloc(int n, int m)
+{
+    GraphCSR *csr = malloc(sizeof(GraphCSR));
+    if (csr == NULL) {
+        return NULL;
+    }
+    csr->n = n;
+    csr->m = m;
+    csr->mapping = NULL;
+    csr->mapping_size = 0;
+    csr->offsets = calloc(n + 1, sizeof(int));
+    csr->targets = malloc((m > 0 ? m : 1) * sizeof(int));
+    if (csr->offsets == NULL || csr->targets == NULL) {
+        free(csr->offsets);
+        free(csr->targets);
+        free(csr);
+        return NULL;
+    }
+    return csr;
+}
+
+/**
+ * Continues a 64-bit FNV-1a hash over a block of bytes.
+ */
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Returns the checksum stored in the files written by graph_save.
+ */
+static uint64_t csr_checksum(const GraphCSR *csr)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fnv1a(hash, csr->offsets, (size_t)(csr->n + 1) * sizeof(int));
+    hash = fnv1a(hash, csr->targets, (size_t)csr->m * sizeof(int));
+    return hash;
+}
+
+/**
+ * Orders edge pairs by source, then target.
+ */
+static int compare_edges(const void *p1, const void *p2)
+{
+    const int *e1 = p1;
+    const int *e2 = p2;
+    if (e1[0] != e2[0]) {
+        return e1[0] < e2[0] ? -1 : 1;
+    }
+    return (e1[1] > e2[1]) - (e1[1] < e2[1]);
+}
+
+/**
+ * Copies and sorts a list of edge pairs, checking that the nodes are valid.
+ */
+static int *sorted_edges(const int *edges, int k, int n)
+{
+    int *sorted = malloc((k > 0 ? k : 1) * 2 * sizeof(int));
+    if (sorted == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < 2 * k; i++) {
+        if (edges[i] < 0 || edges[i] >= n) {
+            free(sorted);
+            return NULL;
+        }
+        sorted[i] = edges[i];
+    }
+    qsort(sorted, k, 2 * sizeof(int), compare_edges);
+    return sorted;
+}
+
+/**
+ * Builds a new GraphCSR from an old one and sorted lists of edges to insert
+ * and remove. Every row is a merge of the old row and the inserted edges,
+ * skipping the removed ones.
+ */
+static GraphCSR *csr_apply(const GraphCSR *old, const int *ins, int no_of_ins, const int *rem, int no_of_rem)
+{
+    GraphCSR *csr = csr_alloc(old->n, old->m + no_of_ins);
+    if (csr == NULL) {
+        return NULL;
+    }
+
+    int e = 0;
+    int i = 0;
+    int r = 0;
+    for (int v = 0; v < old->n; v++) {
+        int j = old->offsets[v];
+        csr->offsets[v] = e;
+
+        for (;;) {
+            int a = j < old->offsets[v + 1] ? old->targets[j] : INT_MAX;
+            int b = i < no_of_ins && ins[2 * i] == v ? ins[2 * i + 1] : INT_MAX;
+            int w = a < b ? a : b;
+            if (w == INT_MAX) {
+                break;
+            }
+            j += a == w;
+            while (i < no_of_ins && ins[2 * i] == v && ins[2 * i + 1] == w) {
+                i++;
+            }
+
+            while (r < no_of_rem && (rem[2 * r] < v || (rem[2 * r] == v && rem[2 * r + 1] < w))) {
+                r++;
+            }
+            if (r < no_of_rem && rem[2 * r] == v && rem[2 * r + 1] == w) {
+                continue;
+            }
+            csr->targets[e++] = w;
+        }
+    }
+    csr->offsets[old->n] = e;
+    csr->m = e;
+
+    return csr;
+}
+
+/**
+ * Frees the replaced versions that no reader can see any longer.
+ *
+ * A reader that announced epoch e may hold any version that was current in
+ * epoch e or later, so a version replaced in epoch r is safe to free once
+ * every reader has announced an epoch of at least r.
+ */
+static void versioned_reclaim(VersionedGraph *vg)
+{
+    long long oldest = READER_IDLE;
+    for (int i = 0; i < vg->max_readers; i++) {
+        long long e = atomic_load(&vg->announced[i]);
+        if (e < oldest) {
+            oldest = e;
+        }
+    }
+
+    struct graph_version **link = &vg->retired;
+    while (*link != NULL) {
+        struct graph_version *version = *link;
+        if (version->retired <= oldest) {
+            *link = version->next;
+            graph_csr_destroy(version->csr);
+            free(version);
+        } else {
+            link = &version->next;
+        }
+    }
+}
+
+/**
+ * Recomputes the contribution of every node from its current score.
+ */
+static void pagerank_refresh_contrib(PageRank *pr)
+{
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int u = 0; u < pr->n; u++) {
+        int degree = pr->out->offsets[u + 1] - pr->out->offsets[u];
+        pr->contrib[u] = degree > 0 ? pr->rank[u] / degree : 0.0;
+    }
+}
+
+/**
+ * Returns the total score of the nodes without outgoing edges.
+ */
+static double pagerank_dangling_mass(const PageRank *pr)
+{
+    double mass = 0.0;
+    for (int u = 0; u < pr->n; u++) {
+        if (pr->out->offsets[u + 1] == pr->out->offsets[u]) {
+            mass += pr->rank[u];
+        }
+    }
+    return mass;
+}
+
+/**
+ * Computes the new score of a node from the contributions of its predecessors.
+ */
+static double pagerank_pull(const PageRank *pr, int v, double dangling)
+{
+    const int *src = pr->in->targets;
+    double sum = 0.0;
+    for (int e = pr->in->offsets[v]; e < pr->in->offsets[v + 1]; e++) {
+        sum += pr->contrib[src[e]];
+    }
+    return (1.0 - pr->damping) * pr->teleport[v]
+           + pr->damping * (sum + dangling * pr->teleport[v]);
+}
+
+/**
+ * Returns the index of the lowest set bit of a non-zero 64-bit word.
+ */
+static int lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!(word & ((uint64_t)1 << bit))) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/**
+ * Parses a node index at p, which must start with a digit, and returns the
+ * position after it, or NULL if there is no valid index.
+ *
+ * With at least eight bytes left, numbers of up to seven digits are parsed
+ * eight bytes at a time: the first non-digit is found with bit tricks on a
+ * 64-bit word, and the digits are combined in three multiplications, so
+ * the varying lengths of the numbers cause no branch mispredictions.
+ */
+static const char *parse_node(const char *p, const char *end, int *node)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (end - p >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        uint64_t digits = word ^ 0x3030303030303030ULL;
+        // The high bit of a byte is set if it is not a digit. Carries only
+        // go up from bytes that are already marked, so the lowest mark is right.
+        uint64_t marks = ((digits + 0x7676767676767676ULL) | digits) & 0x8080808080808080ULL;
+        if (marks != 0) {
+            int length = lowest_bit(marks) / 8;
+            if (length == 0) {
+                return NULL;
+            }
+            // Move the digits to the top, leaving zero digits in front of them
+            uint64_t value = digits << (64 - 8 * length);
+            value = ((value & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+            value = ((value & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+            value = ((value & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+            *node = (int)value;
+            return p + length;
+        }
+    }
+#endif
+
+    if (p == end || (unsigned)(*p - '0') > 9) {
+        return NULL;
+    }
+    long long value = 0;
+    while (p < end && (unsigned)(*p - '0') <= 9) {
+        value = value * 10 + (*p - '0');
+        if (value > INT32_MAX - 1) {
+            return NULL;
+        }
+        p++;
+    }
+    *node = (int)value;
+    return p;
+}
+
+/**
+ * Parses the edges of a text edge list between p and end into src and dst.
+ *
+ * Returns the number of
+ * edges, or -1 if the text is malformed. The largest node index seen is
+ * stored in max_node.
+ */
+static long long parse_edge_chunk(const char *p, const char *end, int *src, int *dst, int *max_node)
+{
+    long long count = 0;
+
+    while (p < end) {
+        // Skip blank space and empty lines
+        if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+            p++;
+            continue;
+        }
+
+        // Skip comment lines
+        if (*p == '#' || *p == '%') {
+            while (p < end && *p != '\n') {
+                p++;
+            }
+            continue;
+        }
+
+        int node[2];
+        for (int k = 0; k < 2; k++) {
+            while (p < end && (*p == ' ' || *p == '\t')) {
+                p++;
+            }
+            p = parse_node(p, end, &node[k]);
+            if (p == NULL) {
+                return -1;
+            }
+        }
+
+        // Ignore the rest of the line, e.g. edge weights
+        while (p < end && *p != '\n') {
+            p++;
+        }
+
+        src[count] = node[0];
+        dst[count] = node[1];
+        if (node[0] > *max_node) {
+            *max_node = node[0];
+        }
+        if (node[1] > *max_node) {
+            *max_node = node[1];
+        }
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Parses a memory-mapped text edge list into two arrays of edge endpoints.
+ *
+ * The text is split into one chunk per thread at line boundaries. The lines
+ * of every chunk are counted with memchr, which bounds its number of edges,
+ * so each chunk is parsed only once, straight into its own slice of the
+ * arrays. The slices are then moved together to close the gaps left by
+ * comment and blank lines.
+ */
+static long long parse_edge_text(const char *text, size_t size, int **src_out, int **dst_out, int *max_node)
+{
+    int chunks = 1;
+#ifdef _OPENMP
+    chunks = omp_get_max_threads();
+#endif
+    if ((size_t)chunks > size / 4096 + 1) {
+        chunks = (int)(size / 4096 + 1);
+    }
+
+    size_t *bound = malloc((chunks + 1) * sizeof(size_t));
+    long long *start = malloc(chunks * sizeof(long long));
+    long long *count = malloc(chunks * sizeof(long long));
+    int *chunk_max = malloc(chunks * sizeof(int));
+    if (!bound || !start || !count || !chunk_max) {
+        free(bound);
+        free(start);
+        free(count);
+        free(chunk_max);
+        return -1;
+    }
+
+    bound[0] = 0;
+    for (int c = 1; c < chunks; c++) {
+        size_t b = size / chunks * c;
+        if (b < bound[c - 1]) {
+            b = bound[c - 1];
+        }
+        while (b < size && text[b - 1] != '\n') {
+            b++;
+        }
+        bound[c] = b;
+    }
+    bound[chunks] = size;
+
+    // A chunk has at most one edge per line, the last one maybe unterminated
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static, 1)
+#endif
+    for (int c = 0; c < chunks; c++) {
+        long long lines = 1;
+        const char *p = text + bound[c];
+        const char *end = text + bound[c + 1];
+        while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+            lines++;
+            p++;
+        }
+        count[c] = lines;
+    }
+
+    long long capacity = 0;
+    for (int c = 0; c < chunks; c++) {
+        start[c] = capacity;
+        capacity += count[c];
+    }
+    int *src = malloc(capacity * sizeof(int));
+    int *dst = malloc(capacity * sizeof(int));
+    int failed = src == NULL || dst == NULL;
+
+    if (!failed) {
+#ifdef _OPENMP
+        #pragma omp parallel for schedule(static, 1) reduction(|:failed)
+#endif
+        for (int c = 0; c < chunks; c++) {
+            chunk_max[c] = -1;
+            count[c] = parse_edge_chunk(text + bound[c], text + bound[c + 1],
+                                        src + start[c], dst + start[c], &chunk_max[c]);
+            failed |= count[c] < 0;
+        }
+    }
+
+    long long total = 0;
+    if (!failed) {
+        for (int c = 0; c < chunks; c++) {
+            memmove(src + total, src + start[c], count[c] * sizeof(int));
+            memmove(dst + total, dst + start[c], count[c] * sizeof(int));
+            total += count[c];
+            if (chunk_max[c] > *max_node) {
+                *max_node = chunk_max[c];
+            }
+        }
+    }
+
+    free(bound);
+    free(start);
+    free(count);
+    free(chunk_max);
+
+    if (failed) {
+        free(src);
+        free(dst);
+        return -1;
+    }
+
+    *src_out = src;
+    *dst_out = dst;
+    return total;
+}
+
+/**
+ * Builds the undirected adjacency of the graph without self-loops.
+ */
+static GraphCSR *csr_symmetric(Graph *g)
+{
+    GraphCSR *out = graph_csr_create(g);
+    GraphCSR *in = out ? graph_csr_transpose(out) : NULL;
+    GraphCSR *sym = in ? csr_alloc(g->n, out->m + in->m) : NULL;
+    if (sym == NULL) {
+        if (out != NULL) {
+            graph_csr_destroy(out);
+        }
+        if (in != NULL) {
+            graph_csr_destroy(in);
+        }
+        return NULL;
+    }
+
+    // Both rows are sorted, so they can be merged without duplicates
+    int e = 0;
+    for (int v = 0; v < g->n; v++) {
+        int i = out->offsets[v];
+        int j = in->offsets[v];
+        sym->offsets[v] = e;
+        while (i < out->offsets[v + 1] || j < in->offsets[v + 1]) {
+            int a = i < out->offsets[v + 1] ? out->targets[i] : g->n;
+            int b = j < in->offsets[v + 1] ? in->targets[j] : g->n;
+            int w = a < b ? a : b;
+            i += a == w;
+            j += b == w;
+            if (w != v) {
+                sym->targets[e++] = w;
+            }
+        }
+    }
+    sym->offsets[g->n] = e;
+    sym->m = e;
+
+    graph_csr_destroy(out);
+    graph_csr_destroy(in);
+    return sym;
+}
+
+/**
+ * Orders the nodes by decreasing degree, keeping equal degrees in index order.
+ */
+static bool order_by_degree(const GraphCSR *sym, int *order)
+{
+    int n = sym->n;
+    int max_degree = 0;
+    for (int v = 0; v < n; v++) {
+        int degree = sym->offsets[v + 1] - sym->offsets[v];
+        max_degree = degree > max_degree ? degree : max_degree;
+    }
+
+    int *start = calloc(max_degree + 2, sizeof(int));
+    if (start == NULL) {
+        return false;
+    }
+    for (int v = 0; v < n; v++) {
+        start[max_degree - (sym->offsets[v + 1] - sym->offsets[v]) + 1]++;
+    }
+    for (int d = 0; d <= max_degree; d++) {
+        start[d + 1] += start[d];
+    }
+    for (int v = 0; v < n; v++) {
+        order[start[max_degree - (sym->offsets[v + 1] - sym->offsets[v])]++] = v;
+    }
+    free(start);
+    return true;
+}
+
+/**
+ * Orders the nodes with the reverse Cuthill-McKee algorithm.
+ *
+ * Every component is traversed breadth-first from a node of minimum degree,
+ * visiting the neighbours of each node in increasing degree order. The
+ * resulting order is reversed.
+ */
+static bool order_rcm(const GraphCSR *sym, int *order)
+{
+    int n = sym->n;
+    int *by_degree = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *rank = malloc((n > 0 ? n : 1) * sizeof(int));
+    char *visited = calloc(n > 0 ? n : 1, sizeof(char));
+
+    if (!by_degree || !rank || !visited || !order_by_degree(sym, by_degree)) {
+        free(by_degree);
+        free(rank);
+        free(visited);
+        return false;
+    }
+
+    // Visit the nodes in increasing degree order by reversing the degree order
+    for (int i = 0; i < n / 2; i++) {
+        int tmp = by_degree[i];
+        by_degree[i] = by_degree[n - 1 - i];
+        by_degree[n - 1 - i] = tmp;
+    }
+    for (int i = 0; i < n; i++) {
+        rank[by_degree[i]] = i;
+    }
+
+    int tail = 0;
+    for (int s = 0; s < n; s++) {
+        int root = by_degree[s];
+        if (visited[root]) {
+            continue;
+        }
+        visited[root] = 1;
+        int head = tail;
+        order[tail++] = root;
+
+        while (head < tail) {
+            int v = order[head++];
+            int first = tail;
+            for (int e = sym->offsets[v]; e < sym->offsets[v + 1]; e++) {
+                int w = sym->targets[e];
+                if (!visited[w]) {
+                    visited[w] = 1;
+                    order[tail++] = w;
+                }
+            }
+
+            // Sort the new nodes by degree with an insertion sort, as the
+            // number of neighbours of a node is usually small
+            for (int i = first + 1; i < tail; i++) {
+                int w = order[i];
+                int j = i;
+                while (j > first && rank[order[j - 1]] > rank[w]) {
+                    order[j] = order[j - 1];
+                    j--;
+                }
+                order[j] = w;
+            }
+        }
+    }
+
+    for (int i = 0; i < n / 2; i++) {
+        int tmp = order[i];
+        order[i] = order[n - 1 - i];
+        order[n - 1 - i] = tmp;
+    }
+
+    free(by_degree);
+    free(rank);
+    free(visited);
+    return true;
+}
+
+/**
+ * Entry in the priority queue used by order_gorder.
+ */
+struct gorder_entry {
+    int score;
+    int node;
+};
+
+/**
+ * Pushes an entry onto a binary max-heap, growing it when needed.
+ */
+static bool gorder_push(struct gorder_entry **heap, int *size, int *capacity, int score, int node)
+{
+    if (*size == *capacity) {
+        int new_capacity = *capacity * 2;
+        struct gorder_entry *grown = realloc(*heap, new_capacity * sizeof(struct gorder_entry));
+        if (grown == NULL) {
+            return false;
+        }
+        *heap = grown;
+        *capacity = new_capacity;
+    }
+
+    struct gorder_entry *h = *heap;
+    int i = (*size)++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (h[parent].score > score || (h[parent].score == score && h[parent].node < node)) {
+            break;
+        }
+        h[i] = h[parent];
+        i = parent;
+    }
+    h[i].score = score;
+    h[i].node = node;
+    return true;
+}
+
+/**
+ * Removes the largest entry from a binary max-heap.
+ */
+static struct gorder_entry gorder_pop(struct gorder_entry *h, int *size)
+{
+    struct gorder_entry top = h[0];
+    struct gorder_entry last = h[--(*size)];
+    int i = 0;
+
+    while (2 * i + 1 < *size) {
+        int child = 2 * i + 1;
+        if (child + 1 < *size && (h[child + 1].score > h[child].score
+            || (h[child + 1].score == h[child].score && h[child + 1].node < h[child].node))) {
+            child++;
+        }
+        if (last.score > h[child].score || (last.score == h[child].score && last.node < h[child].node)) {
+            break;
+        }
+        h[i] = h[child];
+        i = child;
+    }
+    h[i] = last;
+    return top;
+}
+
+/**
+ * Adds delta to the score of the unplaced neighbours and siblings of v.
+ *
+ * A sibling is a node that shares a neighbour with v. Neighbours with a very
+ * high degree are not expanded, as they relate almost every node to every other.
+ */
+static bool gorder_update(const GraphCSR *sym, int v, int delta, int *score, const char *placed,
+                          struct gorder_entry **heap, int *size, int *capacity)
+{
+    const int hub_degree = 256;
+
+    for (int e = sym->offsets[v]; e < sym->offsets[v + 1]; e++) {
+        int w = sym->targets[e];
+        int degree = sym->offsets[w + 1] - sym->offsets[w];
+
+        // w itself is a neighbour, and its neighbours are siblings of v
+        for (int f = sym->offsets[w] - 1; f < sym->offsets[w + 1]; f++) {
+            int u = f < sym->offsets[w] ? w : sym->targets[f];
+            if (f >= sym->offsets[w] && degree > hub_degree) {
+                break;
+            }
+            if (placed[u]) {
+                continue;
+            }
+            score[u] += delta;
+            if (delta > 0 && !gorder_push(heap, size, capacity, score[u], u)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Orders the nodes with a greedy Gorder-like heuristic.
+ *
+ * The next node is always the unplaced node that has the most neighbours and
+ * siblings among the last few placed nodes. Scores are kept in a lazy max-heap:
+ * increases push a new entry, and outdated entries are fixed when popped.
+ */
+static bool order_gorder(const GraphCSR *sym, int *order)
+{
+    const int window = 5;
+    int n = sym->n;
+    int size = 0;
+    int capacity = 2 * n + 16;
+    int *score = calloc(n > 0 ? n : 1, sizeof(int));
+    char *placed = calloc(n > 0 ? n : 1, sizeof(char));
+    struct gorder_entry *heap = malloc(capacity * sizeof(struct gorder_entry));
+    bool ok = score != NULL && placed != NULL && heap != NULL;
+
+    // Start from a node of maximum degree
+    int start = 0;
+    for (int v = 0; ok && v < n; v++) {
+        if (sym->offsets[v + 1] - sym->offsets[v] > sym->offsets[start + 1] - sym->offsets[start]) {
+            start = v;
+        }
+        ok = gorder_push(&heap, &size, &capacity, 0, v);
+    }
+
+    for (int i = 0; ok && i < n; i++) {
+        int v = start;
+        if (i > 0) {
+            for (;;) {
+                struct gorder_entry top = gorder_pop(heap, &size);
+                if (placed[top.node] || top.score < score[top.node]) {
+                    continue;
+                }
+                if (top.score > score[top.node]) {
+                    ok = gorder_push(&heap, &size, &capacity, score[top.node], top.node);
+                    continue;
+                }
+                v = top.node;
+                break;
+            }
+        }
+        if (!ok) {
+            break;
+        }
+
+        placed[v] = 1;
+        order[i] = v;
+        ok = gorder_update(sym, v, 1, score, placed, &heap, &size, &capacity);
+        if (ok && i >= window) {
+            ok = gorder_update(sym, order[i - window], -1, score, placed, &heap, &size, &capacity);
+        }
+    }
+
+    free(score);
+    free(placed);
+    free(heap);
+    return ok;
+}
+
+/**
+ * Builds the edges between the strongly connected components of the graph,
+ * without duplicates and without edges inside a component.
+ */
+static GraphCSR *csr_condensation(Graph *g, const int *component, int k)
+{
+    GraphCSR *out = graph_csr_create(g);
+    int *last = malloc((k > 0 ? k : 1) * sizeof(int));
+    int *count = calloc(k + 1, sizeof(int));
+    int *members = malloc((g->n > 0 ? g->n : 1) * sizeof(int));
+    GraphCSR *dag = NULL;
+    bool ok = out != NULL && last != NULL && count != NULL && members != NULL;
+
+    if (ok) {
+        // Group the nodes by component
+        for (int v = 0; v < g->n; v++) {
+            count[component[v] + 1]++;
+        }
+        for (int c = 0; c < k; c++) {
+            count[c + 1] += count[c];
+        }
+        for (int v = 0; v < g->n; v++) {
+            members[count[component[v]]++] = v;
+        }
+        for (int c = k; c > 0; c--) {
+            count[c] = count[c - 1];
+        }
+        count[0] = 0;
+    }
+
+    // First pass counts the distinct successors, second pass fills them in
+    for (int pass = 0; ok && pass < 2; pass++) {
+        int e = 0;
+        for (int c = 0; c < k; c++) {
+            last[c] = -1;
+        }
+        for (int c = 0; c < k; c++) {
+            if (pass == 1) {
+                dag->offsets[c] = e;
+            }
+            for (int i = count[c]; i < count[c + 1]; i++) {
+                int v = members[i];
+                for (int j = out->offsets[v]; j < out->offsets[v + 1]; j++) {
+                    int d = component[out->targets[j]];
+                    if (d != c && last[d] != c) {
+                        last[d] = c;
+                        if (pass == 1) {
+                            dag->targets[e] = d;
+                        }
+                        e++;
+                    }
+                }
+            }
+        }
+        if (pass == 0) {
+            dag = csr_alloc(k, e);
+            ok = dag != NULL;
+        } else {
+            dag->offsets[k] = e;
+        }
+    }
+
+    if (out != NULL) {
+        graph_csr_destroy(out);
+    }
+    free(last);
+    free(count);
+    free(members);
+    return dag;
+}
+
+/**
+ * Computes one GRAIL interval label for every node of a DAG.
+ *
+ * The DAG is traversed depth-first from the roots in a random order, visiting
+ * the successors of every node from a random offset. The label of a node is
+ * [low, post], where post is its post-order number and low is the smallest
+ * post-order number among its descendants. If b is reachable from a, the
+ * label of b lies within the label of a.
+ */
+static bool grail_label(const GraphCSR *dag, int *low, int *high)
+{
+    int k = dag->n;
+    int *roots = malloc((k > 0 ? k : 1) * sizeof(int));
+    int *stack = malloc((k > 0 ? k : 1) * sizeof(int));
+    int *cursor = malloc((k > 0 ? k : 1) * sizeof(int));
+    int *start = malloc((k > 0 ? k : 1) * sizeof(int));
+    if (!roots || !stack || !cursor || !start) {
+        free(roots);
+        free(stack);
+        free(cursor);
+        free(start);
+        return false;
+    }
+
+    for (int c = 0; c < k; c++) {
+        roots[c] = c;
+        cursor[c] = -1;
+    }
+    for (int c = k - 1; c > 0; c--) {
+        int j = rand() % (c + 1);
+        int tmp = roots[c];
+        roots[c] = roots[j];
+        roots[j] = tmp;
+    }
+
+    int post = 0;
+    for (int r = 0; r < k; r++) {
+        int root = roots[r];
+        if (cursor[root] != -1) {
+            continue;
+        }
+
+        int top = 0;
+        stack[top++] = root;
+        int degree = dag->offsets[root + 1] - dag->offsets[root];
+        start[root] = degree > 0 ? rand() % degree : 0;
+        cursor[root] = 0;
+        low[root] = k;
+
+        while (top > 0) {
+            int v = stack[top - 1];
+            int degree = dag->offsets[v + 1] - dag->offsets[v];
+
+            if (cursor[v] < degree) {
+                int i = (start[v] + cursor[v]++) % degree;
+                int w = dag->targets[dag->offsets[v] + i];
+                if (cursor[w] == -1) {
+                    // Descend into w. A DAG has no edges back to the nodes
+                    // on the stack, so every other w is already labelled
+                    int w_degree = dag->offsets[w + 1] - dag->offsets[w];
+                    start[w] = w_degree > 0 ? rand() % w_degree : 0;
+                    cursor[w] = 0;
+                    low[w] = k;
+                    stack[top++] = w;
+                } else if (low[w] < low[v]) {
+                    low[v] = low[w];
+                }
+                continue;
+            }
+
+            top--;
+            high[v] = post++;
+            if (high[v] < low[v]) {
+                low[v] = high[v];
+            }
+            if (top > 0 && low[v] < low[stack[top - 1]]) {
+                low[stack[top - 1]] = low[v];
+            }
+        }
+    }
+
+    free(roots);
+    free(stack);
+    free(cursor);
+    free(start);
+    return true;
+}
+
+/**
+ * Checks if the labels of component b lie within the labels of component a.
+ */
+static bool grail_contains(const ReachabilityIndex *idx, int a, int b)
+{
+    for (int l = 0; l < idx->labels; l++) {
+        int i = l * idx->no_of_components;
+        if (idx->low[i + b] < idx->low[i + a] || idx->high[i + b] > idx->high[i + a]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Runs one batch of at most 64 * MSBFS_WORDS searches of graph_msbfs.
+ *
+ * seen, visit and next hold MSBFS_WORDS words per node and must be zeroed.
+ */
+static void msbfs_batch(const GraphCSR *csr, const int *sources, int k, int *dist,
+                        uint64_t *seen, uint64_t *visit, uint64_t *next)
+{
+    int n = csr->n;
+
+    for (int i = 0; i < k; i++) {
+        int s = sources[i];
+        seen[s * MSBFS_WORDS + i / 64] |= (uint64_t)1 << (i % 64);
+        visit[s * MSBFS_WORDS + i / 64] |= (uint64_t)1 << (i % 64);
+        dist[(size_t)i * n + s] = 0;
+    }
+
+    for (int level = 1; ; level++) {
+        bool active = false;
+
+        for (int v = 0; v < n; v++) {
+            const uint64_t *vv = visit + (size_t)v * MSBFS_WORDS;
+            uint64_t any = 0;
+            for (int w = 0; w < MSBFS_WORDS; w++) {
+                any |= vv[w];
+            }
+            if (any == 0) {
+                continue;
+            }
+
+            for (int e = csr->offsets[v]; e < csr->offsets[v + 1]; e++) {
+                int u = csr->targets[e];
+                uint64_t *su = seen + (size_t)u * MSBFS_WORDS;
+                uint64_t *nu = next + (size_t)u * MSBFS_WORDS;
+                for (int w = 0; w < MSBFS_WORDS; w++) {
+                    uint64_t fresh = vv[w] & ~su[w];
+                    nu[w] |= fresh;
+                    su[w] |= fresh;
+                }
+            }
+        }
+
+        // Record the distances of the nodes reached on this level
+        for (int u = 0; u < n; u++) {
+            uint64_t *nu = next + (size_t)u * MSBFS_WORDS;
+            for (int w = 0; w < MSBFS_WORDS; w++) {
+                uint64_t bits = nu[w];
+                active |= bits != 0;
+                while (bits != 0) {
+                    dist[(size_t)(w * 64 + lowest_bit(bits)) * n + u] = level;
+                    bits &= bits - 1;
+                }
+            }
+        }
+
+        if (!active) {
+            break;
+        }
+
+        uint64_t *tmp = visit;
+        visit = next;
+        next = tmp;
+        memset(next, 0, (size_t)n * MSBFS_WORDS * sizeof(uint64_t));
+    }
+}
+
+/**
+ * Growable stack of the nodes on the current path of a depth-first traversal.
+ */
+struct dfs_stack {
+    int size;
+    int capacity;
+    int *node;      /* Node of every stack frame */
+    int *cursor;    /* Smallest neighbour not yet tried in every stack frame */
+};
+
+/**
+ * Pushes a node onto a DFS stack, doubling its capacity when it is full.
+ */
+static bool dfs_push(struct dfs_stack *st, int node)
+{
+    if (st->size == st->capacity) {
+        int capacity = st->capacity > 0 ? st->capacity * 2 : 64;
+        int *nodes = realloc(st->node, capacity * sizeof(int));
+        if (nodes == NULL) {
+            return false;
+        }
+        st->node = nodes;
+        int *cursors = realloc(st->cursor, capacity * sizeof(int));
+        if (cursors == NULL) {
+            return false;
+        }
+        st->cursor = cursors;
+        st->capacity = capacity;
+    }
+    st->node[st->size] = node;
+    st->cursor[st->size] = 0;
+    st->size++;
+    return true;
+}
+
+/**
+ * Runs a depth-first traversal from src over the nodes not yet visited.
+ *
+ * state is 0 for unvisited nodes, 1 for nodes on the stack and 2 for finished
+ * nodes. If an edge back to a node on the stack is found, cycle is set.
+ */
+static bool dfs_run(Graph *g, int src, char *state, struct dfs_stack *st,
+                    GraphVisit pre, GraphVisit post, void *ctx, bool *cycle)
+{
+    if (!dfs_push(st, src)) {
+        return false;
+    }
+    state[src] = 1;
+    if (pre != NULL) {
+        pre(src, ctx);
+    }
+
+    while (st->size > 0) {
+        int top = st->size - 1;
+        int v = st->node[top];
+        int w = set_next(st->cursor[top], g->edges[v]);
+
+        if (w != -1 && w < g->n) {
+            st->cursor[top] = w + 1;
+            if (state[w] == 0) {
+                if (!dfs_push(st, w)) {
+                    return false;
+                }
+                state[w] = 1;
+                if (pre != NULL) {
+                    pre(w, ctx);
+                }
+            } else if (state[w] == 1) {
+                *cycle = true;
+            }
+            continue;
+        }
+
+        st->size--;
+        state[v] = 2;
+        if (post != NULL) {
+            post(v, ctx);
+        }
+    }
+    return true;
+}
+
+/**
+ * Context of the post-order callback used by graph_topological_sort.
+ */
+struct topo_order {
+    int *order;
+    int next;
+};
+
+/**
+ * Places every finished node before the ones finished earlier.
+ */
+static void topo_place(int node, void *ctx)
+{
+    struct topo_order *topo = ctx;
+    topo->order[--topo->next] = node;
+}
+
+/* ---------------------- External functions ---------------------- */
+
+
+Graph *graph_create(int n) 
+{
+    Graph *g = malloc(sizeof(Graph));
+    if (!g) {
+        perror("Error in graph_create: Allocation failed");
+        return NULL;
+    }
+
+    g->n = n;
+    g->edges = calloc(n, sizeof(set *));
+    if (!g->edges) {
+        perror("Error in graph_create: Edges allocation failed");
+        free(g);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++) {
+        g->edges[i] = set_empty();
+        if (!g->edges[i]) {
+            for (int j = 0; j < i; j++) {
+                set_destroy(g->edges[j]);
+            }
+            free(g->edges);
+            free(g);
+            return NULL;
+        }
+    }
+
+    return g;
+}
+
+Graph *graph_load_edgelist(const char *path, GraphFormat format)
+{
+    if (path == NULL) {
+        perror("Error in graph_load_edgelist: Null path");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("Error in graph_load_edgelist: Could not open file");
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("Error in graph_load_edgelist: Could not stat file");
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const char *data = NULL;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("Error in graph_load_edgelist: Could not map file");
+            close(fd);
+            return NULL;
+        }
+        posix_madvise((void *)data, size, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    int *src = NULL;
+    int *dst = NULL;
+    int max_node = -1;
+    long long m = 0;
+
+    if (format == GRAPH_FORMAT_TEXT) {
+        m = parse_edge_text(data, size, &src, &dst, &max_node);
+    } else if (format == GRAPH_FORMAT_BINARY && size % (2 * sizeof(int32_t)) == 0) {
+        m = (long long)(size / (2 * sizeof(int32_t)));
+        src = malloc((m > 0 ? m : 1) * sizeof(int));
+        dst = malloc((m > 0 ? m : 1) * sizeof(int));
+        if (src == NULL || dst == NULL) {
+            m = -1;
+        }
+        for (long long e = 0; e < m; e++) {
+            int32_t pair[2];
+            memcpy(pair, data + e * sizeof(pair), sizeof(pair));
+            if (pair[0] < 0 || pair[1] < 0 || pair[0] >= INT32_MAX || pair[1] >= INT32_MAX) {
+                m = -1;
+                break;
+            }
+            src[e] = pair[0];
+            dst[e] = pair[1];
+            max_node = pair[0] > max_node ? pair[0] : max_node;
+            max_node = pair[1] > max_node ? pair[1] : max_node;
+        }
+    } else {
+        m = -1;
+    }
+
+    if (size > 0) {
+        munmap((void *)data, size);
+    }
+    if (m < 0) {
+        perror("Error in graph_load_edgelist: Malformed edge list");
+        free(src);
+        free(dst);
+        return NULL;
+    }
+
+    Graph *g = graph_create(max_node + 1);
+    int *capacity = calloc((size_t)max_node + 2, sizeof(int));
+    if (g == NULL || capacity == NULL) {
+        perror("Error in graph_load_edgelist: Allocation failed");
+        if (g != NULL) {
+            graph_destroy(g);
+        }
+        free(capacity);
+        free(src);
+        free(dst);
+        return NULL;
+    }
+
+    // Size every adjacency set once, then fill it without reallocations
+    for (long long e = 0; e < m; e++) {
+        if (dst[e] + 1 > capacity[src[e]]) {
+            capacity[src[e]] = dst[e] + 1;
+        }
+    }
+    for (int i = 0; i < g->n; i++) {
+        set_reserve(capacity[i], g->edges[i]);
+    }
+    for (long long e = 0; e < m; e++) {
+        set_insert(dst[e], g->edges[src[e]]);
+    }
+
+    free(capacity);
+    free(src);
+    free(dst);
+    return g;
+}
+
+void graph_insert_edge(Graph *g, int a, int b) 
+{
+    if (a < 0 || b < 0 || a >= g->n || b >= g->n) {
+        perror("Error in graph_insert_edge: Invalid node index");
+        return;
+    }
+    set_insert(b, g->edges[a]);
+}
+
+set *graph_neighbours(Graph *g, int node) 
+{
+    if (node < 0 || node >= g->n) {
+        perror("Error in graph_neighbours: Invalid node index");
+        return NULL;
+    }
+    return g->edges[node];
+}
+
+int graph_no_of_nodes(Graph *g) 
+{
+    if (g == NULL) {
+        perror("Error in graph_no_of_nodes: Null graph pointer");
+        return -1;
+    }
+    return g->n;
+}
+
+void graph_remove_edge(Graph *g, int a, int b) 
+{
+    if (g == NULL) {
+        perror("Error in graph_remove_edge: Null graph pointer");
+        return;
+    }
+    if (a < 0 || b < 0 || a >= g->n || b >= g->n) {
+        perror("Error in graph_remove_edge: Invalid node index");
+        return;
+    }
+    set_remove(b, g->edges[a]);
+}
+
+void graph_remove_node(Graph *g, int node) 
+{
+    if (g == NULL || node < 0 || node >= g->n) {
+        perror("Error in graph_remove_node: Invalid parameters");
+        return;
+    }
+
+    set_destroy(g->edges[node]);
+
+    for (int i = 0; i < g->n; i++) {
+        if (i != node) {
+            set_remove(node, g->edges[i]);
+        }
+    }
+
+    for (int i = node; i < g->n - 1; i++) {
+        g->edges[i] = g->edges[i + 1];
+    }
+
+    g->n--;
+}
+
+bool graph_dfs(Graph *g, int src, GraphVisit pre, GraphVisit post, void *ctx)
+{
+    if (g == NULL || src < 0 || src >= g->n) {
+        perror("Error in graph_dfs: Invalid parameters");
+        return false;
+    }
+
+    char *state = calloc(g->n, sizeof(char));
+    struct dfs_stack st = {0, 0, NULL, NULL};
+    bool cycle = false;
+    bool ok = state != NULL && dfs_run(g, src, state, &st, pre, post, ctx, &cycle);
+    if (!ok) {
+        perror("Error in graph_dfs: Allocation failed");
+    }
+
+    free(state);
+    free(st.node);
+    free(st.cursor);
+    return ok;
+}
+
+int *graph_topological_sort(Graph *g)
+{
+    if (g == NULL) {
+        perror("Error in graph_topological_sort: Null graph pointer");
+        return NULL;
+    }
+
+    char *state = calloc(g->n > 0 ? g->n : 1, sizeof(char));
+    struct topo_order topo = {malloc((g->n > 0 ? g->n : 1) * sizeof(int)), g->n};
+    struct dfs_stack st = {0, 0, NULL, NULL};
+    bool cycle = false;
+    bool ok = state != NULL && topo.order != NULL;
+
+    for (int v = 0; ok && !cycle && v < g->n; v++) {
+        if (state[v] == 0) {
+            ok = dfs_run(g, v, state, &st, NULL, topo_place, &topo, &cycle);
+        }
+    }
+
+    free(state);
+    free(st.node);
+    free(st.cursor);
+
+    if (!ok) {
+        perror("Error in graph_topological_sort: Allocation failed");
+    }
+    if (!ok || cycle) {
+        free(topo.order);
+        return NULL;
+    }
+    return topo.order;
+}
+
+int *graph_weakly_connected_components(Graph *g, int *no_of_components)
+{
+    if (g == NULL) {
+        perror("Error in graph_weakly_connected_components: Null graph pointer");
+        return NULL;
+    }
+
+    int n = g->n > 0 ? g->n : 1;
+    atomic_int *parent = malloc(n * sizeof(atomic_int));
+    int *component = malloc(n * sizeof(int));
+    if (parent == NULL || component == NULL) {
+        perror("Error in graph_weakly_connected_components: Allocation failed");
+        free(parent);
+        free(component);
+        return NULL;
+    }
+
+    for (int i = 0; i < g->n; i++) {
+        atomic_init(&parent[i], i);
+    }
+
+    // Every thread links the roots of its edges; the unions are lock-free
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 64)
+#endif
+    for (int a = 0; a < g->n; a++) {
+        for (int b = set_next(0, g->edges[a]); b != -1; b = set_next(b + 1, g->edges[a])) {
+            if (b < g->n) {
+                uf_union(parent, a, b);
+            }
+        }
+    }
+
+    // Roots are the smallest node of each set, so they are visited before
+    // the rest of their set and can be numbered in a single pass.
+    int count = 0;
+    for (int i = 0; i < g->n; i++) {
+        int root = uf_find(parent, i);
+        component[i] = root == i ? count++ : component[root];
+    }
+    free(parent);
+
+    if (no_of_components != NULL) {
+        *no_of_components = count;
+    }
+    return component;
+}
+
+int *graph_strongly_connected_components(Graph *g, int *no_of_components)
+{
+    if (g == NULL) {
+        perror("Error in graph_strongly_connected_components: Null graph pointer");
+        return NULL;
+    }
+
+    int n = g->n > 0 ? g->n : 1;
+    int *component = malloc(n * sizeof(int));
+    int *index = malloc(n * sizeof(int));
+    int *lowlink = malloc(n * sizeof(int));
+    int *cursor = malloc(n * sizeof(int));
+    int *call_stack = malloc(n * sizeof(int));
+    int *scc_stack = malloc(n * sizeof(int));
+
+    if (!component || !index || !lowlink || !cursor || !call_stack || !scc_stack) {
+        perror("Error in graph_strongly_connected_components: Allocation failed");
+        free(component);
+        free(index);
+        free(lowlink);
+        free(cursor);
+        free(call_stack);
+        free(scc_stack);
+        return NULL;
+    }
+
+    for (int i = 0; i < g->n; i++) {
+        index[i] = -1;
+        component[i] = -1;
+    }
+
+    int next_index = 0;
+    int count = 0;
+    int scc_top = 0;
+
+    for (int root = 0; root < g->n; root++) {
+        if (index[root] != -1) {
+            continue;
+        }
+
+        int call_top = 0;
+        call_stack[call_top++] = root;
+        index[root] = lowlink[root] = next_index++;
+        cursor[root] = 0;
+        scc_stack[scc_top++] = root;
+
+        while (call_top > 0) {
+            int v = call_stack[call_top - 1];
+            int w = set_next(cursor[v], g->edges[v]);
+
+            if (w != -1 && w < g->n) {
+                cursor[v] = w + 1;
+                if (index[w] == -1) {
+                    // Descend into w
+                    index[w] = lowlink[w] = next_index++;
+                    cursor[w] = 0;
+                    scc_stack[scc_top++] = w;
+                    call_stack[call_top++] = w;
+                } else if (component[w] == -1 && index[w] < lowlink[v]) {
+                    // w is still on the SCC stack
+                    lowlink[v] = index[w];
+                }
+                continue;
+            }
+
+            // All neighbours of v are done
+            call_top--;
+            if (lowlink[v] == index[v]) {
+                int u;
+                do {
+                    u = scc_stack[--scc_top];
+                    component[u] = count;
+                } while (u != v);
+                count++;
+            }
+            if (call_top > 0) {
+                int parent = call_stack[call_top - 1];
+                if (lowlink[v] < lowlink[parent]) {
+                    lowlink[parent] = lowlink[v];
+                }
+            }
+        }
+    }
+
+    free(index);
+    free(lowlink);
+    free(cursor);
+    free(call_stack);
+    free(scc_stack);
+
+    if (no_of_components != NULL) {
+        *no_of_components = count;
+    }
+    return component;
+}
+
+long long graph_triangle_count(Graph *g)
+{
+    if (g == NULL) {
+        perror("Error in graph_triangle_count: Null graph pointer");
+        return -1;
+    }
+
+    set **nb = undirected_neighbours(g, NULL);
+    long long *rank = malloc((g->n > 0 ? g->n : 1) * sizeof(long long));
+    if (nb == NULL || rank == NULL) {
+        perror("Error in graph_triangle_count: Allocation failed");
+        destroy_sets(nb, g->n);
+        free(rank);
+        return -1;
+    }
+
+    // Order by degree and break ties by node index
+    for (int i = 0; i < g->n; i++) {
+        rank[i] = (long long)set_size(nb[i]) * g->n + i;
+    }
+    destroy_sets(nb, g->n);
+
+    set **out = undirected_neighbours(g, rank);
+    free(rank);
+    if (out == NULL) {
+        perror("Error in graph_triangle_count: Allocation failed");
+        return -1;
+    }
+
+    long long count = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 64) reduction(+:count)
+#endif
+    for (int u = 0; u < g->n; u++) {
+        for (int v = set_next(0, out[u]); v != -1; v = set_next(v + 1, out[u])) {
+            count += set_intersection_size(out[u], out[v]);
+        }
+    }
+
+    destroy_sets(out, g->n);
+    return count;
+}
+
+double *graph_local_clustering(Graph *g)
+{
+    if (g == NULL) {
+        perror("Error in graph_local_clustering: Null graph pointer");
+        return NULL;
+    }
+
+    set **nb = undirected_neighbours(g, NULL);
+    double *coefficient = malloc((g->n > 0 ? g->n : 1) * sizeof(double));
+    if (nb == NULL || coefficient == NULL) {
+        perror("Error in graph_local_clustering: Allocation failed");
+        destroy_sets(nb, g->n);
+        free(coefficient);
+        return NULL;
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 64)
+#endif
+    for (int u = 0; u < g->n; u++) {
+        long long degree = set_size(nb[u]);
+        long long links = 0;
+
+        // Every link between two neighbours is seen from both ends
+        for (int v = set_next(0, nb[u]); v != -1; v = set_next(v + 1, nb[u])) {
+            links += set_intersection_size(nb[u], nb[v]);
+        }
+
+        coefficient[u] = degree < 2 ? 0.0 : (double)links / (double)(degree * (degree - 1));
+    }
+
+    destroy_sets(nb, g->n);
+    return coefficient;
+}
+
+bool graph_reorder(Graph *g, GraphOrder order, int *perm_out)
+{
+    if (g == NULL) {
+        perror("Error in graph_reorder: Null graph pointer");
+        return false;
+    }
+
+    int n = g->n > 0 ? g->n : 1;
+    GraphCSR *sym = csr_symmetric(g);
+    int *sequence = malloc(n * sizeof(int));
+    int *perm = malloc(n * sizeof(int));
+    set **edges = calloc(n, sizeof(set *));
+    bool ok = sym != NULL && sequence != NULL && perm != NULL && edges != NULL;
+
+    if (ok) {
+        switch (order) {
+        case GRAPH_ORDER_DEGREE:
+            ok = order_by_degree(sym, sequence);
+            break;
+        case GRAPH_ORDER_RCM:
+            ok = order_rcm(sym, sequence);
+            break;
+        case GRAPH_ORDER_GORDER:
+            ok = order_gorder(sym, sequence);
+            break;
+        default:
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        for (int i = 0; i < g->n; i++) {
+            perm[sequence[i]] = i;
+        }
+    }
+
+    // Build the relabelled adjacency sets before touching the graph
+    for (int a = 0; ok && a < g->n; a++) {
+        set *s = set_empty();
+        if (s == NULL) {
+            ok = false;
+            break;
+        }
+        edges[perm[a]] = s;
+
+        int capacity = 0;
+        for (int b = set_next(0, g->edges[a]); b != -1 && b < g->n; b = set_next(b + 1, g->edges[a])) {
+            capacity = perm[b] >= capacity ? perm[b] + 1 : capacity;
+        }
+        set_reserve(capacity, s);
+        for (int b = set_next(0, g->edges[a]); b != -1 && b < g->n; b = set_next(b + 1, g->edges[a])) {
+            set_insert(perm[b], s);
+        }
+    }
+
+    if (ok) {
+        for (int i = 0; i < g->n; i++) {
+            set_destroy(g->edges[i]);
+        }
+        free(g->edges);
+        g->edges = edges;
+        if (perm_out != NULL) {
+            memcpy(perm_out, perm, g->n * sizeof(int));
+        }
+    } else {
+        perror("Error in graph_reorder: Reordering failed");
+        destroy_sets(edges, g->n);
+    }
+
+    if (sym != NULL) {
+        graph_csr_destroy(sym);
+    }
+    free(sequence);
+    free(perm);
+    return ok;
+}
+
+ReachabilityIndex *graph_reachability_index(Graph *g, int labels)
+{
+    if (g == NULL || labels < 0) {
+        perror("Error in graph_reachability_index: Invalid parameters");
+        return NULL;
+    }
+
+    ReachabilityIndex *idx = calloc(1, sizeof(ReachabilityIndex));
+    if (idx == NULL) {
+        perror("Error in graph_reachability_index: Allocation failed");
+        return NULL;
+    }
+
+    idx->n = g->n;
+    idx->labels = labels;
+    idx->component = graph_strongly_connected_components(g, &idx->no_of_components);
+    int k = idx->no_of_components;
+    GraphCSR *dag = idx->component ? csr_condensation(g, idx->component, k) : NULL;
+    bool ok = dag != NULL;
+
+    if (ok && labels == 0) {
+        // Components are numbered in reverse topological order, so all
+        // successors of a component are complete before it is reached
+        idx->reach = calloc(k > 0 ? k : 1, sizeof(set *));
+        ok = idx->reach != NULL;
+        for (int c = 0; ok && c < k; c++) {
+            idx->reach[c] = set_empty();
+            if (idx->reach[c] == NULL) {
+                ok = false;
+                break;
+            }
+            set_reserve(c + 1, idx->reach[c]);
+            set_insert(c, idx->reach[c]);
+            for (int e = dag->offsets[c]; e < dag->offsets[c + 1]; e++) {
+                set_merge(idx->reach[c], idx->reach[dag->targets[e]]);
+            }
+        }
+        graph_csr_destroy(dag);
+    } else if (ok) {
+        idx->dag = dag;
+        idx->low = malloc((size_t)labels * (k > 0 ? k : 1) * sizeof(int));
+        idx->high = malloc((size_t)labels * (k > 0 ? k : 1) * sizeof(int));
+        idx->visited = calloc(k > 0 ? k : 1, sizeof(int));
+        idx->stack = malloc((k > 0 ? k : 1) * sizeof(int));
+        ok = idx->low && idx->high && idx->visited && idx->stack;
+        for (int l = 0; ok && l < labels; l++) {
+            ok = grail_label(dag, idx->low + (size_t)l * k, idx->high + (size_t)l * k);
+        }
+    }
+
+    if (!ok) {
+        perror("Error in graph_reachability_index: Allocation failed");
+        graph_reachability_index_destroy(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+bool graph_reachable(ReachabilityIndex *idx, int a, int b)
+{
+    if (idx == NULL || a < 0 || b < 0 || a >= idx->n || b >= idx->n) {
+        perror("Error in graph_reachable: Invalid parameters");
+        return false;
+    }
+
+    int ca = idx->component[a];
+    int cb = idx->component[b];
+
+    if (idx->reach != NULL) {
+        return set_member_of(cb, idx->reach[ca]);
+    }
+    if (ca == cb) {
+        return true;
+    }
+    if (!grail_contains(idx, ca, cb)) {
+        return false;
+    }
+
+    // The labels could not rule the pair out, so search the DAG and skip
+    // every component whose labels do not contain the target
+    if (++idx->stamp == 0) {
+        memset(idx->visited, 0, idx->no_of_components * sizeof(int));
+        idx->stamp = 1;
+    }
+    int top = 0;
+    idx->stack[top++] = ca;
+    idx->visited[ca] = idx->stamp;
+
+    while (top > 0) {
+        int c = idx->stack[--top];
+        for (int e = idx->dag->offsets[c]; e < idx->dag->offsets[c + 1]; e++) {
+            int d = idx->dag->targets[e];
+            if (d == cb) {
+                return true;
+            }
+            if (idx->visited[d] != idx->stamp && grail_contains(idx, d, cb)) {
+                idx->visited[d] = idx->stamp;
+                idx->stack[top++] = d;
+            }
+        }
+    }
+    return false;
+}
+
+void graph_reachability_index_destroy(ReachabilityIndex *idx)
+{
+    if (idx == NULL) {
+        perror("Error in graph_reachability_index_destroy: Null pointer received");
+        return;
+    }
+    if (idx->reach != NULL) {
+        destroy_sets(idx->reach, idx->no_of_components);
+    }
+    if (idx->dag != NULL) {
+        graph_csr_destroy(idx->dag);
+    }
+    free(idx->component);
+    free(idx->low);
+    free(idx->high);
+    free(idx->visited);
+    free(idx->stack);
+    free(idx);
+}
+
+bool graph_msbfs(Graph *g, const int *sources, int k, int *dist)
+{
+    if (g == NULL || (sources == NULL && k > 0) || dist == NULL || k < 0) {
+        perror("Error in graph_msbfs: Invalid parameters");
+        return false;
+    }
+    for (int i = 0; i < k; i++) {
+        if (sources[i] < 0 || sources[i] >= g->n) {
+            perror("Error in graph_msbfs: Invalid node index");
+            return false;
+        }
+    }
+
+    size_t words = (size_t)(g->n > 0 ? g->n : 1) * MSBFS_WORDS;
+    GraphCSR *csr = graph_csr_create(g);
+    uint64_t *seen = malloc(words * sizeof(uint64_t));
+    uint64_t *visit = malloc(words * sizeof(uint64_t));
+    uint64_t *next = malloc(words * sizeof(uint64_t));
+    if (csr == NULL || seen == NULL || visit == NULL || next == NULL) {
+        perror("Error in graph_msbfs: Allocation failed");
+        if (csr != NULL) {
+            graph_csr_destroy(csr);
+        }
+        free(seen);
+        free(visit);
+        free(next);
+        return false;
+    }
+
+    for (size_t i = 0; i < (size_t)k * g->n; i++) {
+        dist[i] = -1;
+    }
+
+    for (int first = 0; first < k; first += 64 * MSBFS_WORDS) {
+        int batch = k - first < 64 * MSBFS_WORDS ? k - first : 64 * MSBFS_WORDS;
+        memset(seen, 0, words * sizeof(uint64_t));
+        memset(visit, 0, words * sizeof(uint64_t));
+        memset(next, 0, words * sizeof(uint64_t));
+        msbfs_batch(csr, sources + first, batch, dist + (size_t)first * g->n, seen, visit, next);
+    }
+
+    graph_csr_destroy(csr);
+    free(seen);
+    free(visit);
+    free(next);
+    return true;
+}
+
+int *graph_degrees(Graph *g, GraphDegree kind)
+{
+    if (g == NULL) {
+        perror("Error in graph_degrees: Null graph pointer");
+        return NULL;
+    }
+
+    int *degree = calloc(g->n > 0 ? g->n : 1, sizeof(int));
+    if (degree == NULL) {
+        perror("Error in graph_degrees: Allocation failed");
+        return NULL;
+    }
+
+    if (kind == GRAPH_DEGREE_OUT) {
+        for (int v = 0; v < g->n; v++) {
+            degree[v] = set_size(g->edges[v]);
+        }
+    } else if (kind == GRAPH_DEGREE_IN) {
+        for (int a = 0; a < g->n; a++) {
+            for (int b = set_next(0, g->edges[a]); b != -1 && b < g->n; b = set_next(b + 1, g->edges[a])) {
+                degree[b]++;
+            }
+        }
+    } else {
+        GraphCSR *sym = csr_symmetric(g);
+        if (sym == NULL) {
+            perror("Error in graph_degrees: Allocation failed");
+            free(degree);
+            return NULL;
+        }
+        for (int v = 0; v < g->n; v++) {
+            degree[v] = sym->offsets[v + 1] - sym->offsets[v];
+        }
+        graph_csr_destroy(sym);
+    }
+
+    return degree;
+}
+
+int *graph_degree_histogram(Graph *g, GraphDegree kind, int *max_degree)
+{
+    int *degree = graph_degrees(g, kind);
+    if (degree == NULL) {
+        return NULL;
+    }
+
+    int max = 0;
+    for (int v = 0; v < g->n; v++) {
+        max = degree[v] > max ? degree[v] : max;
+    }
+
+    int *histogram = calloc(max + 1, sizeof(int));
+    if (histogram == NULL) {
+        perror("Error in graph_degree_histogram: Allocation failed");
+        free(degree);
+        return NULL;
+    }
+    for (int v = 0; v < g->n; v++) {
+        histogram[degree[v]]++;
+    }
+    free(degree);
+
+    if (max_degree != NULL) {
+        *max_degree = max;
+    }
+    return histogram;
+}
+
+int *graph_kcore(Graph *g, int *max_core)
+{
+    if (g == NULL) {
+        perror("Error in graph_kcore: Null graph pointer");
+        return NULL;
+    }
 
+    int n = g->n;
+    GraphCSR *sym = csr_symmetric(g);
+    int *core = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *order = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *position = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *start = NULL;
+    int max_degree = 0;
 
-Graph *graph_create(int n) 
+    if (sym != NULL) {
+        for (int v = 0; v < n; v++) {
+            int degree = sym->offsets[v + 1] - sym->offsets[v];
+            max_degree = degree > max_degree ? degree : max_degree;
+        }
+        start = calloc(max_degree + 2, sizeof(int));
+    }
+    if (!sym || !core || !order || !position || !start) {
+        perror("Error in graph_kcore: Allocation failed");
+        if (sym != NULL) {
+            graph_csr_destroy(sym);
+        }
+        free(core);
+        free(order);
+        free(position);
+        free(start);
+        return NULL;
+    }
+
+    // Sort the nodes by degree into buckets, where start[d] is the first
+    // position of the bucket with degree d
+    for (int v = 0; v < n; v++) {
+        core[v] = sym->offsets[v + 1] - sym->offsets[v];
+        start[core[v] + 1]++;
+    }
+    for (int d = 0; d <= max_degree; d++) {
+        start[d + 1] += start[d];
+    }
+    for (int v = 0; v < n; v++) {
+        position[v] = start[core[v]]++;
+        order[position[v]] = v;
+    }
+    for (int d = max_degree; d > 0; d--) {
+        start[d] = start[d - 1];
+    }
+    start[0] = 0;
+
+    // Peel the nodes in order. Moving a neighbour down one bucket is a swap
+    // with the first node of its bucket.
+    int max = 0;
+    for (int i = 0; i < n; i++) {
+        int v = order[i];
+        max = core[v] > max ? core[v] : max;
+        for (int e = sym->offsets[v]; e < sym->offsets[v + 1]; e++) {
+            int u = sym->targets[e];
+            if (core[u] > core[v]) {
+                int first = order[start[core[u]]];
+                if (first != u) {
+                    order[position[u]] = first;
+                    position[first] = position[u];
+                    order[start[core[u]]] = u;
+                    position[u] = start[core[u]];
+                }
+                start[core[u]]++;
+                core[u]--;
+            }
+        }
+    }
+
+    graph_csr_destroy(sym);
+    free(order);
+    free(position);
+    free(start);
+
+    if (max_core != NULL) {
+        *max_core = max;
+    }
+    return core;
+}
+
+int *graph_kcore_parallel(Graph *g, int *max_core)
 {
-    Graph *g = malloc(sizeof(Graph));
-    if (!g) {
-        perror("Error in graph_create: Allocation failed");
+    if (g == NULL) {
+        perror("Error in graph_kcore_parallel: Null graph pointer");
         return NULL;
     }
 
-    g->n = n;
-    g->edges = calloc(n, sizeof(set *));
-    if (!g->edges) {
-        perror("Error in graph_create: Edges allocation failed");
-        free(g);
+    int n = g->n;
+    GraphCSR *sym = csr_symmetric(g);
+    atomic_int *degree = malloc((n > 0 ? n : 1) * sizeof(atomic_int));
+    int *core = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *frontier = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *next = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!sym || !degree || !core || !frontier || !next) {
+        perror("Error in graph_kcore_parallel: Allocation failed");
+        if (sym != NULL) {
+            graph_csr_destroy(sym);
+        }
+        free(degree);
+        free(core);
+        free(frontier);
+        free(next);
         return NULL;
     }
 
-    for (int i = 0; i < n; i++) {
-        g->edges[i] = set_empty();
-        if (!g->edges[i]) {
-            for (int j = 0; j < i; j++) {
-                set_destroy(g->edges[j]);
+    for (int v = 0; v < n; v++) {
+        atomic_init(&degree[v], sym->offsets[v + 1] - sym->offsets[v]);
+    }
+
+    int peeled = 0;
+    int k = 0;
+    while (peeled < n) {
+        // Start the level with every remaining node of degree at most k.
+        // Peeled nodes get a negative degree.
+        int size = 0;
+        for (int v = 0; v < n; v++) {
+            int d = atomic_load_explicit(&degree[v], memory_order_relaxed);
+            if (d >= 0 && d <= k) {
+                atomic_store_explicit(&degree[v], -1, memory_order_relaxed);
+                core[v] = k;
+                frontier[size++] = v;
             }
-            free(g->edges);
-            free(g);
-            return NULL;
         }
+
+        while (size > 0) {
+            peeled += size;
+            atomic_int next_size;
+            atomic_init(&next_size, 0);
+
+#ifdef _OPENMP
+            #pragma omp parallel for schedule(dynamic, 64)
+#endif
+            for (int i = 0; i < size; i++) {
+                int v = frontier[i];
+                for (int e = sym->offsets[v]; e < sym->offsets[v + 1]; e++) {
+                    int u = sym->targets[e];
+                    if (atomic_load_explicit(&degree[u], memory_order_relaxed) <= k) {
+                        continue;
+                    }
+                    // Exactly one decrement takes u from k + 1 to k
+                    int old = atomic_fetch_sub_explicit(&degree[u], 1, memory_order_relaxed);
+                    if (old == k + 1) {
+                        atomic_store_explicit(&degree[u], -1, memory_order_relaxed);
+                        core[u] = k;
+                        next[atomic_fetch_add_explicit(&next_size, 1, memory_order_relaxed)] = u;
+                    }
+                }
+            }
+
+            int *tmp = frontier;
+            frontier = next;
+            next = tmp;
+            size = atomic_load(&next_size);
+        }
+        k++;
     }
 
-    return g;
+    graph_csr_destroy(sym);
+    free(degree);
+    free(frontier);
+    free(next);
+
+    if (max_core != NULL) {
+        *max_core = n > 0 ? k - 1 : 0;
+    }
+    return core;
 }
 
-void graph_insert_edge(Graph *g, int a, int b) 
+GraphCSR *graph_csr_create(Graph *g)
 {
-    if (a < 0 || b < 0 || a >= g->n || b >= g->n) {
-        perror("Error in graph_insert_edge: Invalid node index");
-        return;
+    if (g == NULL) {
+        perror("Error in graph_csr_create: Null graph pointer");
+        return NULL;
     }
-    set_insert(b, g->edges[a]);
+
+    // First pass counts the edges, second pass fills them in
+    int m = 0;
+    for (int a = 0; a < g->n; a++) {
+        for (int b = set_next(0, g->edges[a]); b != -1 && b < g->n; b = set_next(b + 1, g->edges[a])) {
+            m++;
+        }
+    }
+
+    GraphCSR *csr = csr_alloc(g->n, m);
+    if (csr == NULL) {
+        perror("Error in graph_csr_create: Allocation failed");
+        return NULL;
+    }
+
+    int e = 0;
+    for (int a = 0; a < g->n; a++) {
+        csr->offsets[a] = e;
+        for (int b = set_next(0, g->edges[a]); b != -1 && b < g->n; b = set_next(b + 1, g->edges[a])) {
+            csr->targets[e++] = b;
+        }
+    }
+    csr->offsets[g->n] = e;
+
+    return csr;
 }
 
-set *graph_neighbours(Graph *g, int node) 
+GraphCSR *graph_csr_transpose(const GraphCSR *csr)
 {
-    if (node < 0 || node >= g->n) {
-        perror("Error in graph_neighbours: Invalid node index");
+    if (csr == NULL) {
+        perror("Error in graph_csr_transpose: Null pointer received");
         return NULL;
     }
-    return g->edges[node];
+
+    GraphCSR *t = csr_alloc(csr->n, csr->m);
+    if (t == NULL) {
+        perror("Error in graph_csr_transpose: Allocation failed");
+        return NULL;
+    }
+
+    for (int e = 0; e < csr->m; e++) {
+        t->offsets[csr->targets[e] + 1]++;
+    }
+    for (int i = 0; i < csr->n; i++) {
+        t->offsets[i + 1] += t->offsets[i];
+    }
+
+    // Sources are visited in increasing order, so every row ends up sorted
+    int *fill = malloc((csr->n > 0 ? csr->n : 1) * sizeof(int));
+    if (fill == NULL) {
+        perror("Error in graph_csr_transpose: Allocation failed");
+        graph_csr_destroy(t);
+        return NULL;
+    }
+    memcpy(fill, t->offsets, csr->n * sizeof(int));
+
+    for (int a = 0; a < csr->n; a++) {
+        for (int e = csr->offsets[a]; e < csr->offsets[a + 1]; e++) {
+            t->targets[fill[csr->targets[e]]++] = a;
+        }
+    }
+    free(fill);
+
+    return t;
 }
 
-int graph_no_of_nodes(Graph *g) 
+bool graph_save(Graph *g, const char *path)
+{
+    if (g == NULL || path == NULL) {
+        perror("Error in graph_save: Null pointer received");
+        return false;
+    }
+
+    GraphCSR *csr = graph_csr_create(g);
+    char *tmp_path = malloc(strlen(path) + 5);
+    if (csr == NULL || tmp_path == NULL) {
+        perror("Error in graph_save: Allocation failed");
+        if (csr != NULL) {
+            graph_csr_destroy(csr);
+        }
+        free(tmp_path);
+        return false;
+    }
+    strcpy(tmp_path, path);
+    strcat(tmp_path, ".tmp");
+
+    struct graph_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_FILE_VERSION;
+    header.byte_order = GRAPH_FILE_BYTE_ORDER;
+    header.n = csr->n;
+    header.m = csr->m;
+    header.checksum = csr_checksum(csr);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    bool ok = fp != NULL
+              && fwrite(&header, sizeof(header), 1, fp) == 1
+              && fwrite(csr->offsets, sizeof(int), csr->n + 1, fp) == (size_t)csr->n + 1
+              && fwrite(csr->targets, sizeof(int), csr->m, fp) == (size_t)csr->m;
+    if (fp != NULL && fclose(fp) != 0) {
+        ok = false;
+    }
+    if (ok && rename(tmp_path, path) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        perror("Error in graph_save: Could not write file");
+        remove(tmp_path);
+    }
+
+    graph_csr_destroy(csr);
+    free(tmp_path);
+    return ok;
+}
+
+GraphCSR *graph_open(const char *path, bool verify)
+{
+    if (path == NULL) {
+        perror("Error in graph_open: Null path");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("Error in graph_open: Could not open file");
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(struct graph_file_header)) {
+        perror("Error in graph_open: File is too small");
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Error in graph_open: Could not map file");
+        return NULL;
+    }
+
+    const struct graph_file_header *header = data;
+    bool ok = memcmp(header->magic, GRAPH_FILE_MAGIC, sizeof(header->magic)) == 0
+              && header->version == GRAPH_FILE_VERSION
+              && header->byte_order == GRAPH_FILE_BYTE_ORDER
+              && header->n >= 0 && header->m >= 0
+              && size == sizeof(*header) + ((size_t)header->n + 1 + (size_t)header->m) * sizeof(int);
+
+    GraphCSR *csr = ok ? malloc(sizeof(GraphCSR)) : NULL;
+    if (csr != NULL) {
+        csr->n = header->n;
+        csr->m = header->m;
+        csr->offsets = (int *)((char *)data + sizeof(*header));
+        csr->targets = csr->offsets + csr->n + 1;
+        csr->mapping = data;
+        csr->mapping_size = size;
+        if (verify && csr_checksum(csr) != header->checksum) {
+            free(csr);
+            csr = NULL;
+        }
+    }
+
+    if (csr == NULL) {
+        perror("Error in graph_open: Invalid or corrupt file");
+        munmap(data, size);
+    }
+    return csr;
+}
+
+void graph_csr_destroy(GraphCSR *csr)
+{
+    if (csr == NULL) {
+        perror("Error in graph_csr_destroy: Null pointer received");
+        return;
+    }
+    if (csr->mapping != NULL) {
+        munmap(csr->mapping, csr->mapping_size);
+    } else {
+        free(csr->offsets);
+        free(csr->targets);
+    }
+    free(csr);
+}
+
+PageRank *graph_pagerank_create(Graph *g, double damping, const double *personalization)
 {
     if (g == NULL) {
-        perror("Error in graph_no_of_nodes: Null graph pointer");
+        perror("Error in graph_pagerank_create: Null graph pointer");
+        return NULL;
+    }
+
+    PageRank *pr = calloc(1, sizeof(PageRank));
+    if (pr == NULL) {
+        perror("Error in graph_pagerank_create: Allocation failed");
+        return NULL;
+    }
+
+    int n = g->n > 0 ? g->n : 1;
+    pr->n = g->n;
+    pr->damping = damping;
+    pr->out = graph_csr_create(g);
+    pr->in = pr->out ? graph_csr_transpose(pr->out) : NULL;
+    pr->teleport = malloc(n * sizeof(double));
+    pr->rank = malloc(n * sizeof(double));
+    pr->contrib = malloc(n * sizeof(double));
+    pr->next = malloc(n * sizeof(double));
+
+    if (!pr->out || !pr->in || !pr->teleport || !pr->rank || !pr->contrib || !pr->next) {
+        perror("Error in graph_pagerank_create: Allocation failed");
+        graph_pagerank_destroy(pr);
+        return NULL;
+    }
+
+    double total = 0.0;
+    for (int i = 0; i < pr->n; i++) {
+        total += personalization ? personalization[i] : 1.0;
+    }
+    if (total <= 0.0) {
+        perror("Error in graph_pagerank_create: Personalization sums to zero");
+        graph_pagerank_destroy(pr);
+        return NULL;
+    }
+
+    // Touch the arrays with the same partitioning as graph_pagerank_run so
+    // that every thread's pages end up on its own NUMA node
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < pr->n; i++) {
+        pr->teleport[i] = (personalization ? personalization[i] : 1.0) / total;
+        pr->rank[i] = pr->teleport[i];
+        pr->next[i] = 0.0;
+    }
+    pagerank_refresh_contrib(pr);
+
+    return pr;
+}
+
+int graph_pagerank_run(PageRank *pr, double tolerance, int max_iterations)
+{
+    if (pr == NULL) {
+        perror("Error in graph_pagerank_run: Null pointer received");
         return -1;
     }
-    return g->n;
+
+    int iterations = 0;
+    while (iterations < max_iterations) {
+        double dangling = pagerank_dangling_mass(pr);
+        double diff = 0.0;
+
+#ifdef _OPENMP
+        #pragma omp parallel for schedule(static) reduction(+:diff)
+#endif
+        for (int v = 0; v < pr->n; v++) {
+            pr->next[v] = pagerank_pull(pr, v, dangling);
+            diff += fabs(pr->next[v] - pr->rank[v]);
+        }
+
+        double *tmp = pr->rank;
+        pr->rank = pr->next;
+        pr->next = tmp;
+        pagerank_refresh_contrib(pr);
+        iterations++;
+
+        if (diff < tolerance) {
+            break;
+        }
+    }
+
+    return iterations;
 }
 
-void graph_remove_edge(Graph *g, int a, int b) 
+long long graph_pagerank_update(PageRank *pr, Graph *g, const int *changed, int k, double tolerance)
 {
-    if (g == NULL) {
-        perror("Error in graph_remove_edge: Null graph pointer");
+    if (pr == NULL || g == NULL || (changed == NULL && k > 0)) {
+        perror("Error in graph_pagerank_update: Null pointer received");
+        return -1;
+    }
+    if (g->n != pr->n) {
+        perror("Error in graph_pagerank_update: Number of nodes changed");
+        return -1;
+    }
+
+    int n = pr->n > 0 ? pr->n : 1;
+    int *queue = malloc(n * sizeof(int));
+    char *queued = calloc(n, sizeof(char));
+    GraphCSR *out = graph_csr_create(g);
+    GraphCSR *in = out ? graph_csr_transpose(out) : NULL;
+    if (!queue || !queued || !out || !in) {
+        perror("Error in graph_pagerank_update: Allocation failed");
+        free(queue);
+        free(queued);
+        if (out != NULL) {
+            graph_csr_destroy(out);
+        }
+        if (in != NULL) {
+            graph_csr_destroy(in);
+        }
+        return -1;
+    }
+
+    // The queue is circular and holds every node at most once
+    int head = 0;
+    int size = 0;
+
+    // Both the old and the new successors of a changed node have new inputs
+    for (int pass = 0; pass < 2; pass++) {
+        const GraphCSR *edges = pass == 0 ? pr->out : out;
+        for (int i = 0; i < k; i++) {
+            int u = changed[i];
+            if (u < 0 || u >= pr->n) {
+                continue;
+            }
+            for (int e = edges->offsets[u]; e < edges->offsets[u + 1]; e++) {
+                int v = edges->targets[e];
+                if (!queued[v]) {
+                    queued[v] = 1;
+                    queue[(head + size++) % n] = v;
+                }
+            }
+        }
+    }
+
+    graph_csr_destroy(pr->out);
+    graph_csr_destroy(pr->in);
+    pr->out = out;
+    pr->in = in;
+    pagerank_refresh_contrib(pr);
+
+    double dangling = pagerank_dangling_mass(pr);
+    double drift = 0.0;
+    double node_tolerance = tolerance / n;
+    long long work = 0;
+
+    while (size > 0) {
+        int v = queue[head];
+        head = (head + 1) % n;
+        size--;
+        queued[v] = 0;
+        work++;
+
+        double value = pagerank_pull(pr, v, dangling);
+        double delta = value - pr->rank[v];
+        int degree = out->offsets[v + 1] - out->offsets[v];
+
+        pr->rank[v] = value;
+        if (degree == 0) {
+            // The change spreads to every node through the teleport vector
+            drift += delta;
+            continue;
+        }
+        pr->contrib[v] = value / degree;
+
+        if (fabs(delta) > node_tolerance) {
+            for (int e = out->offsets[v]; e < out->offsets[v + 1]; e++) {
+                int w = out->targets[e];
+                if (!queued[w]) {
+                    queued[w] = 1;
+                    queue[(head + size++) % n] = w;
+                }
+            }
+        }
+    }
+
+    free(queue);
+    free(queued);
+
+    if (fabs(drift) > tolerance) {
+        int iterations = graph_pagerank_run(pr, tolerance, 1000);
+        work += (long long)iterations * pr->n;
+    }
+
+    return work;
+}
+
+const double *graph_pagerank_scores(const PageRank *pr)
+{
+    if (pr == NULL) {
+        perror("Error in graph_pagerank_scores: Null pointer received");
+        return NULL;
+    }
+    return pr->rank;
+}
+
+void graph_pagerank_destroy(PageRank *pr)
+{
+    if (pr == NULL) {
+        perror("Error in graph_pagerank_destroy: Null pointer received");
         return;
     }
-    if (a < 0 || b < 0 || a >= g->n || b >= g->n) {
-        perror("Error in graph_remove_edge: Invalid node index");
+    if (pr->in != NULL) {
+        graph_csr_destroy(pr->in);
+    }
+    if (pr->out != NULL) {
+        graph_csr_destroy(pr->out);
+    }
+    free(pr->teleport);
+    free(pr->rank);
+    free(pr->contrib);
+    free(pr->next);
+    free(pr);
+}
+
+VersionedGraph *graph_versioned_create(Graph *g, int max_readers)
+{
+    if (g == NULL || max_readers < 0) {
+        perror("Error in graph_versioned_create: Invalid parameters");
+        return NULL;
+    }
+
+    VersionedGraph *vg = malloc(sizeof(VersionedGraph));
+    struct graph_version *version = malloc(sizeof(struct graph_version));
+    GraphCSR *csr = graph_csr_create(g);
+    atomic_int *registered = malloc((max_readers > 0 ? max_readers : 1) * sizeof(atomic_int));
+    atomic_llong *announced = malloc((max_readers > 0 ? max_readers : 1) * sizeof(atomic_llong));
+    if (!vg || !version || !csr || !registered || !announced) {
+        perror("Error in graph_versioned_create: Allocation failed");
+        free(vg);
+        free(version);
+        if (csr != NULL) {
+            graph_csr_destroy(csr);
+        }
+        free(registered);
+        free(announced);
+        return NULL;
+    }
+
+    version->csr = csr;
+    version->retired = 0;
+    version->next = NULL;
+
+    atomic_init(&vg->current, version);
+    atomic_init(&vg->epoch, 0);
+    vg->max_readers = max_readers;
+    vg->registered = registered;
+    vg->announced = announced;
+    atomic_flag_clear(&vg->writer);
+    vg->retired = NULL;
+
+    for (int i = 0; i < max_readers; i++) {
+        atomic_init(&registered[i], 0);
+        atomic_init(&announced[i], READER_IDLE);
+    }
+
+    return vg;
+}
+
+int graph_versioned_reader_register(VersionedGraph *vg)
+{
+    if (vg == NULL) {
+        perror("Error in graph_versioned_reader_register: Null pointer received");
+        return -1;
+    }
+    for (int i = 0; i < vg->max_readers; i++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&vg->registered[i], &expected, 1)) {
+            return i;
+        }
+    }
+    perror("Error in graph_versioned_reader_register: No free reader slot");
+    return -1;
+}
+
+void graph_versioned_reader_unregister(VersionedGraph *vg, int slot)
+{
+    if (vg == NULL || slot < 0 || slot >= vg->max_readers) {
+        perror("Error in graph_versioned_reader_unregister: Invalid parameters");
         return;
     }
-    set_remove(b, g->edges[a]);
+    atomic_store(&vg->announced[slot], READER_IDLE);
+    atomic_store(&vg->registered[slot], 0);
 }
 
-void graph_remove_node(Graph *g, int node) 
+const GraphCSR *graph_versioned_read_begin(VersionedGraph *vg, int slot)
 {
-    if (g == NULL || node < 0 || node >= g->n) {
-        perror("Error in graph_remove_node: Invalid parameters");
+    if (vg == NULL || slot < 0 || slot >= vg->max_readers) {
+        perror("Error in graph_versioned_read_begin: Invalid parameters");
+        return NULL;
+    }
+
+    // The announcement must be visible before the version is loaded, so that
+    // a writer replacing the version either sees it or is seen by the load
+    atomic_store(&vg->announced[slot], atomic_load(&vg->epoch));
+    return atomic_load(&vg->current)->csr;
+}
+
+void graph_versioned_read_end(VersionedGraph *vg, int slot)
+{
+    if (vg == NULL || slot < 0 || slot >= vg->max_readers) {
+        perror("Error in graph_versioned_read_end: Invalid parameters");
         return;
     }
+    atomic_store(&vg->announced[slot], READER_IDLE);
+}
 
-    set_destroy(g->edges[node]);
+bool graph_versioned_commit(VersionedGraph *vg, const int *inserts, int no_of_inserts,
+                            const int *removes, int no_of_removes)
+{
+    if (vg == NULL || no_of_inserts < 0 || no_of_removes < 0
+        || (inserts == NULL && no_of_inserts > 0) || (removes == NULL && no_of_removes > 0)) {
+        perror("Error in graph_versioned_commit: Invalid parameters");
+        return false;
+    }
 
-    for (int i = 0; i < g->n; i++) {
-        if (i != node) {
-            set_remove(node, g->edges[i]);
+    while (atomic_flag_test_and_set(&vg->writer)) {
+        // Another writer is committing, let it run if it was preempted
+        sched_yield();
+    }
+
+    struct graph_version *old = atomic_load(&vg->current);
+    int n = old->csr->n;
+    int *ins = sorted_edges(inserts, no_of_inserts, n);
+    int *rem = ins ? sorted_edges(removes, no_of_removes, n) : NULL;
+    GraphCSR *csr = rem ? csr_apply(old->csr, ins, no_of_inserts, rem, no_of_removes) : NULL;
+    struct graph_version *version = csr ? malloc(sizeof(struct graph_version)) : NULL;
+    free(ins);
+    free(rem);
+
+    if (version == NULL) {
+        perror("Error in graph_versioned_commit: Invalid edges or allocation failed");
+        if (csr != NULL) {
+            graph_csr_destroy(csr);
         }
+        atomic_flag_clear(&vg->writer);
+        return false;
     }
 
-    for (int i = node; i < g->n - 1; i++) {
-        g->edges[i] = g->edges[i + 1];
+    version->csr = csr;
+    version->retired = 0;
+    version->next = NULL;
+
+    // Publish the new version, then retire the old one in the next epoch
+    atomic_store(&vg->current, version);
+    old->retired = atomic_fetch_add(&vg->epoch, 1) + 1;
+    old->next = vg->retired;
+    vg->retired = old;
+
+    versioned_reclaim(vg);
+    atomic_flag_clear(&vg->writer);
+    return true;
+}
+
+long long graph_versioned_version(VersionedGraph *vg)
+{
+    if (vg == NULL) {
+        perror("Error in graph_versioned_version: Null pointer received");
+        return -1;
     }
+    return atomic_load(&vg->epoch);
+}
 
-    g->n--;
+void graph_versioned_destroy(VersionedGraph *vg)
+{
+    if (vg == NULL) {
+        perror("Error in graph_versioned_destroy: Null pointer received");
+        return;
+    }
+
+    struct graph_version *version = atomic_load(&vg->current);
+    version->next = vg->retired;
+    while (version != NULL) {
+        struct graph_version *next = version->next;
+        graph_csr_destroy(version->csr);
+        free(version);
+        version = next;
+    }
+
+    free(vg->registered);
+    free(vg->announced);
+    free(vg);
 }
 
 void graph_destroy(Graph *g) 
@@ -1,6 +1,8 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include "set.h"
 
 /**
@@ -27,6 +29,106 @@ typedef struct Graph {
     set **edges;    /**< Array of pointers to sets representing adjacency lists for each node.**/
 } Graph;
 
+/**
+ * @brief File formats understood by graph_load_edgelist.
+ */
+typedef enum GraphFormat {
+    GRAPH_FORMAT_TEXT,   /**< One "a b" pair per line. Lines starting with '#' or '%' are comments and extra columns are ignored.**/
+    GRAPH_FORMAT_BINARY  /**< Packed pairs of native-endian 32-bit integers without header.**/
+} GraphFormat;
+
+/**
+ * @brief Node orderings understood by graph_reorder.
+ */
+typedef enum GraphOrder {
+    GRAPH_ORDER_DEGREE, /**< Decreasing degree, so that hub nodes share cache lines.**/
+    GRAPH_ORDER_RCM,    /**< Reverse Cuthill-McKee, which keeps the neighbours of a node close to it.**/
+    GRAPH_ORDER_GORDER  /**< Greedy Gorder-like ordering that places nodes sharing neighbours next to each other.**/
+} GraphOrder;
+
+/**
+ * @brief Function called for every node visited by graph_dfs.
+ *
+ * @param node The visited node.
+ * @param ctx The context pointer given to graph_dfs.
+ */
+typedef void (*GraphVisit)(int node, void *ctx);
+
+/**
+ * @brief Kinds of node degree understood by graph_degrees.
+ */
+typedef enum GraphDegree {
+    GRAPH_DEGREE_OUT,         /**< Number of outgoing edges.**/
+    GRAPH_DEGREE_IN,          /**< Number of incoming edges.**/
+    GRAPH_DEGREE_UNDIRECTED   /**< Number of distinct neighbours, ignoring directions and self-loops.**/
+} GraphDegree;
+
+/**
+ * @brief Contiguous (compressed sparse row) view of the edges of a graph.
+ *
+ * The neighbours of node i are targets[offsets[i]] ... targets[offsets[i + 1] - 1],
+ * in increasing order. Unlike the set-per-node representation, traversing all
+ * edges touches memory sequentially.
+ */
+typedef struct GraphCSR {
+    int n;                  /**< Number of nodes.**/
+    int m;                  /**< Number of edges.**/
+    int *offsets;           /**< Array of n + 1 offsets into targets.**/
+    int *targets;           /**< Array of m edge targets.**/
+    void *mapping;          /**< Memory-mapped file holding the arrays, or NULL if they are allocated.**/
+    size_t mapping_size;    /**< Size of the memory-mapped file.**/
+} GraphCSR;
+
+/**
+ * @brief State of an iterative PageRank computation.
+ *
+ * Keeps the incoming edges in a GraphCSR so that every node pulls the scores of
+ * its predecessors, and keeps the scores between runs so that they can be
+ * updated incrementally after the graph changes.
+ */
+typedef struct PageRank {
+    int n;              /**< Number of nodes.**/
+    double damping;     /**< Probability of following an edge instead of teleporting.**/
+    GraphCSR *in;       /**< Incoming edges of every node.**/
+    GraphCSR *out;      /**< Outgoing edges of every node.**/
+    double *teleport;   /**< Teleport probability of every node, sums to 1.**/
+    double *rank;       /**< Current score of every node.**/
+    double *contrib;    /**< Score divided by out-degree, 0 for dangling nodes.**/
+    double *next;       /**< Scratch array for the next iteration.**/
+} PageRank;
+
+/**
+ * @brief Index that answers whether one node can reach another.
+ *
+ * Every strongly connected component is collapsed into one node of a DAG.
+ * The index either keeps the full transitive closure of the DAG as one
+ * bitmap set per component, or, for graphs too big for that, a few interval
+ * labels per component that rule out most unreachable pairs.
+ */
+typedef struct ReachabilityIndex {
+    int n;                  /**< Number of nodes in the graph.**/
+    int no_of_components;   /**< Number of strongly connected components.**/
+    int *component;         /**< Component of every node.**/
+    set **reach;            /**< Components reachable from every component, or NULL.**/
+    GraphCSR *dag;          /**< Edges between the components, or NULL.**/
+    int labels;             /**< Number of interval labels per component.**/
+    int *low;               /**< Lower interval bounds, labels per component.**/
+    int *high;              /**< Upper interval bounds, labels per component.**/
+    int *visited;           /**< Query stamp of every component, used by the label search.**/
+    int *stack;             /**< Search stack, used by the label search.**/
+    int stamp;              /**< Current query stamp.**/
+} ReachabilityIndex;
+
+/**
+ * @brief Graph that readers can traverse while a writer updates it.
+ *
+ * Every version of the edges is an immutable GraphCSR. Writers build a new
+ * version from the current one and a batch of changes, and publish it with
+ * a single atomic store. Readers announce the current epoch in a slot of
+ * their own, so old versions are only freed once no reader can see them.
+ */
+typedef struct VersionedGraph VersionedGraph;
+
 /**
  * @brief Creates a new graph with a specified number of nodes.
  *
@@ -35,6 +137,20 @@ typedef struct Graph {
  */
 Graph *graph_create(int n);
 
+/**
+ * @brief Creates a graph from a file with a list of edges.
+ *
+ * The file is memory-mapped and parsed in chunks, which are processed in
+ * parallel when the module is compiled with OpenMP. All edges are parsed
+ * before the graph is built, so every adjacency set is allocated once with
+ * its final size. The number of nodes is the largest node index plus one.
+ *
+ * @param path The path of the file.
+ * @param format The format of the file.
+ * @return A pointer to the newly created graph, or NULL on failure.
+ */
+Graph *graph_load_edgelist(const char *path, GraphFormat format);
+
 /**
  * @brief Adds an edge from node a to node b in the graph.
  *
@@ -78,6 +194,417 @@ void graph_remove_edge(Graph *g, int a, int b);
  */
 void graph_remove_node(Graph *g, int node);
 
+/**
+ * @brief Traverses the graph depth-first from a node.
+ *
+ * The neighbours of a node are visited in increasing order. The traversal
+ * keeps its own stack on the heap, which grows as needed, so long chains of
+ * nodes do not overflow the C stack.
+ *
+ * @param g The graph.
+ * @param src The node to start from.
+ * @param pre Function called when a node is first reached, may be NULL.
+ * @param post Function called when all neighbours of a node are done, may be NULL.
+ * @param ctx Context pointer passed to the functions.
+ * @return true on success, false on failure.
+ */
+bool graph_dfs(Graph *g, int src, GraphVisit pre, GraphVisit post, void *ctx);
+
+/**
+ * @brief Orders the nodes so that every edge goes from an earlier node to a later one.
+ *
+ * The order is the reverse post-order of a depth-first traversal from every
+ * unvisited node. The caller is responsible for freeing the returned array.
+ *
+ * @param g The graph.
+ * @return An array of the n nodes in topological order, or NULL if the graph
+ * has a cycle or on failure.
+ */
+int *graph_topological_sort(Graph *g);
+
+/**
+ * @brief Finds the weakly connected components of the graph.
+ *
+ * Edge directions are ignored. The components are found with a union-find
+ * structure using path halving, where every union links the larger root
+ * under the smaller one. No recursion is used, so deep graphs are safe.
+ * When built with OpenMP the edges are processed in parallel; roots are
+ * linked with compare-and-swap, so the unions take no lock and the result
+ * does not depend on the number of threads.
+ *
+ * The component IDs are numbered 0, 1, ... in order of the smallest node
+ * in each component. The caller is responsible for freeing the returned array.
+ *
+ * @param g The graph.
+ * @param no_of_components Output for the number of components, may be NULL.
+ * @return An array of n component IDs, or NULL on failure.
+ */
+int *graph_weakly_connected_components(Graph *g, int *no_of_components);
+
+/**
+ * @brief Finds the strongly connected components of the graph.
+ *
+ * Uses Tarjan's algorithm with an explicit stack instead of recursion,
+ * so long chains do not overflow the C stack.
+ *
+ * The component IDs are numbered 0, 1, ... in the order the components are
+ * completed, which is a reverse topological order of the condensed graph.
+ * The caller is responsible for freeing the returned array.
+ *
+ * @param g The graph.
+ * @param no_of_components Output for the number of components, may be NULL.
+ * @return An array of n component IDs, or NULL on failure.
+ */
+int *graph_strongly_connected_components(Graph *g, int *no_of_components);
+
+/**
+ * @brief Counts the triangles in the graph.
+ *
+ * Edge directions and self-loops are ignored. Every edge is oriented from
+ * the node with lower degree to the node with higher degree, and each
+ * triangle is then counted once as the size of the intersection of two
+ * oriented adjacency bitmaps. Nodes are processed in parallel when the
+ * module is compiled with OpenMP.
+ *
+ * @param g The graph.
+ * @return The number of triangles, or -1 on failure.
+ */
+long long graph_triangle_count(Graph *g);
+
+/**
+ * @brief Computes the local clustering coefficient of every node.
+ *
+ * Edge directions and self-loops are ignored. The coefficient of a node is
+ * the fraction of pairs of its neighbours that are themselves connected, or
+ * 0 for nodes with fewer than two neighbours. The caller is responsible for
+ * freeing the returned array.
+ *
+ * @param g The graph.
+ * @return An array of n coefficients, or NULL on failure.
+ */
+double *graph_local_clustering(Graph *g);
+
+/**
+ * @brief Relabels the nodes of the graph to improve memory locality.
+ *
+ * Edge directions are ignored when the order is computed. After the call,
+ * the node that had index i has index perm_out[i].
+ *
+ * @param g The graph to relabel.
+ * @param order The ordering strategy.
+ * @param perm_out Output array of n new indices, may be NULL.
+ * @return true on success, false on failure, in which case g is unchanged.
+ */
+bool graph_reorder(Graph *g, GraphOrder order, int *perm_out);
+
+/**
+ * @brief Builds a reachability index for the graph.
+ *
+ * With labels set to 0, the full transitive closure is computed by merging
+ * the bitmap sets of the components in reverse topological order, a machine
+ * word at a time. It needs c * c / 8 bytes for c components, and every query
+ * is a single bit lookup.
+ *
+ * With labels above 0, that many GRAIL interval labels are computed from
+ * randomized depth-first traversals instead, using O(labels * c) memory.
+ * A query then rejects most unreachable pairs with the labels and falls back
+ * to a search that is pruned by the labels.
+ *
+ * The index is not updated when the graph changes.
+ *
+ * @param g The graph.
+ * @param labels The number of interval labels, or 0 for the full closure.
+ * @return A pointer to the new index, or NULL on failure.
+ */
+ReachabilityIndex *graph_reachability_index(Graph *g, int labels);
+
+/**
+ * @brief Checks if there is a path from node a to node b.
+ *
+ * A node can always reach itself. With interval labels, queries on the same
+ * index must not run concurrently.
+ *
+ * @param idx The reachability index.
+ * @param a The starting node.
+ * @param b The ending node.
+ * @return true if b can be reached from a, false otherwise.
+ */
+bool graph_reachable(ReachabilityIndex *idx, int a, int b);
+
+/**
+ * @brief Destroys a reachability index, freeing all allocated resources.
+ *
+ * @param idx The reachability index to destroy.
+ */
+void graph_reachability_index_destroy(ReachabilityIndex *idx);
+
+/**
+ * @brief Computes the distances from many sources with one traversal.
+ *
+ * Up to 256 breadth-first searches are run at once. Every node keeps one bit
+ * per search in a few machine words, so a single pass over the edges advances
+ * all searches by one level. More sources are handled in batches.
+ *
+ * @param g The graph.
+ * @param sources The source nodes.
+ * @param k The number of sources.
+ * @param dist Output array of k * n distances, where dist[i * n + v] is the
+ * number of edges from sources[i] to v, or -1 if v cannot be reached.
+ * @return true on success, false on failure.
+ */
+bool graph_msbfs(Graph *g, const int *sources, int k, int *dist);
+
+/**
+ * @brief Returns the degree of every node.
+ *
+ * The caller is responsible for freeing the returned array.
+ *
+ * @param g The graph.
+ * @param kind The kind of degree.
+ * @return An array of n degrees, or NULL on failure.
+ */
+int *graph_degrees(Graph *g, GraphDegree kind);
+
+/**
+ * @brief Counts the nodes of every degree.
+ *
+ * The caller is responsible for freeing the returned array.
+ *
+ * @param g The graph.
+ * @param kind The kind of degree.
+ * @param max_degree Output for the largest degree, may be NULL.
+ * @return An array where element d is the number of nodes with degree d,
+ * for d = 0 ... max_degree, or NULL on failure.
+ */
+int *graph_degree_histogram(Graph *g, GraphDegree kind, int *max_degree);
+
+/**
+ * @brief Computes the core number of every node.
+ *
+ * Edge directions and self-loops are ignored. The core number of a node is
+ * the largest k such that the node belongs to a subgraph where every node has
+ * at least k neighbours. The nodes are peeled in order of degree with a
+ * bucket queue, which takes O(n + m) time. The caller is responsible for
+ * freeing the returned array.
+ *
+ * @param g The graph.
+ * @param max_core Output for the largest core number, may be NULL.
+ * @return An array of n core numbers, or NULL on failure.
+ */
+int *graph_kcore(Graph *g, int *max_core);
+
+/**
+ * @brief Computes the core number of every node in parallel.
+ *
+ * Gives the same result as graph_kcore. For k = 0, 1, ..., all nodes with at
+ * most k remaining neighbours are peeled at once, and the degrees of their
+ * neighbours are decreased with atomic operations. Each level is processed
+ * in parallel when the module is compiled with OpenMP.
+ *
+ * @param g The graph.
+ * @param max_core Output for the largest core number, may be NULL.
+ * @return An array of n core numbers, or NULL on failure.
+ */
+int *graph_kcore_parallel(Graph *g, int *max_core);
+
+/**
+ * @brief Creates a contiguous copy of the edges of a graph.
+ *
+ * The copy is not updated when the graph changes. It is the caller's
+ * responsibility to call graph_csr_destroy to free it.
+ *
+ * @param g The graph.
+ * @return A pointer to the new GraphCSR, or NULL on failure.
+ */
+GraphCSR *graph_csr_create(Graph *g);
+
+/**
+ * @brief Creates a GraphCSR with every edge reversed.
+ *
+ * @param csr The GraphCSR to transpose.
+ * @return A pointer to the new GraphCSR, or NULL on failure.
+ */
+GraphCSR *graph_csr_transpose(const GraphCSR *csr);
+
+/**
+ * @brief Saves the edges of a graph to a binary file.
+ *
+ * The file holds a versioned header with a checksum, followed by the
+ * offsets and targets arrays of a GraphCSR in native byte order. It is
+ * written to a temporary file that is renamed over path when complete, so
+ * an existing file is never left half-written.
+ *
+ * @param g The graph.
+ * @param path The path of the file.
+ * @return true on success, false on failure.
+ */
+bool graph_save(Graph *g, const char *path);
+
+/**
+ * @brief Opens a file written by graph_save as a read-only GraphCSR.
+ *
+ * The file is memory-mapped and its arrays are used in place, so opening
+ * takes constant time and pages are only read when they are traversed.
+ * Checking the checksum reads the whole file and is optional. The arrays
+ * must not be modified. The mapping is released by graph_csr_destroy.
+ *
+ * @param path The path of the file.
+ * @param verify true to check the checksum of the arrays.
+ * @return A pointer to the GraphCSR, or NULL on failure.
+ */
+GraphCSR *graph_open(const char *path, bool verify);
+
+/**
+ * @brief Destroys a GraphCSR, freeing all allocated resources.
+ *
+ * @param csr The GraphCSR to destroy.
+ */
+void graph_csr_destroy(GraphCSR *csr);
+
+/**
+ * @brief Creates a PageRank computation over the graph.
+ *
+ * The scores start out equal to the teleport vector. Call graph_pagerank_run
+ * to compute them.
+ *
+ * @param g The graph.
+ * @param damping The damping factor, usually 0.85.
+ * @param personalization Teleport weight of every node for personalized
+ * PageRank, or NULL for the uniform distribution. The weights are normalized
+ * and copied.
+ * @return A pointer to the new PageRank, or NULL on failure.
+ */
+PageRank *graph_pagerank_create(Graph *g, double damping, const double *personalization);
+
+/**
+ * @brief Iterates PageRank until it converges.
+ *
+ * Every iteration pulls the scores over the incoming edges of all nodes. The
+ * iteration stops when the L1 distance between two iterations is below the
+ * tolerance. The nodes are split evenly between threads when the module is
+ * compiled with OpenMP.
+ *
+ * @param pr The PageRank computation.
+ * @param tolerance The convergence threshold.
+ * @param max_iterations The maximum number of iterations.
+ * @return The number of iterations performed, or -1 on failure.
+ */
+int graph_pagerank_run(PageRank *pr, double tolerance, int max_iterations);
+
+/**
+ * @brief Updates the scores after the edges of some nodes have changed.
+ *
+ * The edges are reloaded from the graph, which must have the same number of
+ * nodes as before. Starting from the current scores, only the nodes whose
+ * inputs changed are recomputed, and the change is propagated to their
+ * successors until it is below the tolerance. If the mass of the dangling
+ * nodes changes too much, a full run is performed instead.
+ *
+ * @param pr The PageRank computation.
+ * @param g The changed graph.
+ * @param changed The nodes whose outgoing edges were inserted or removed.
+ * @param k The number of changed nodes.
+ * @param tolerance The convergence threshold.
+ * @return The number of node recomputations performed, or -1 on failure.
+ */
+long long graph_pagerank_update(PageRank *pr, Graph *g, const int *changed, int k, double tolerance);
+
+/**
+ * @brief Returns the current scores.
+ *
+ * @param pr The PageRank computation.
+ * @return An array of n scores owned by pr.
+ */
+const double *graph_pagerank_scores(const PageRank *pr);
+
+/**
+ * @brief Destroys a PageRank computation, freeing all allocated resources.
+ *
+ * @param pr The PageRank computation to destroy.
+ */
+void graph_pagerank_destroy(PageRank *pr);
+
+/**
+ * @brief Creates a versioned graph whose first version holds the edges of g.
+ *
+ * @param g The graph to copy the edges from.
+ * @param max_readers The maximum number of registered readers.
+ * @return A pointer to the new versioned graph, or NULL on failure.
+ */
+VersionedGraph *graph_versioned_create(Graph *g, int max_readers);
+
+/**
+ * @brief Registers a reader thread.
+ *
+ * @param vg The versioned graph.
+ * @return The reader's slot, to be passed to the read functions, or -1 if
+ * all slots are taken.
+ */
+int graph_versioned_reader_register(VersionedGraph *vg);
+
+/**
+ * @brief Releases the slot of a reader that is not reading.
+ *
+ * @param vg The versioned graph.
+ * @param slot The slot returned by graph_versioned_reader_register.
+ */
+void graph_versioned_reader_unregister(VersionedGraph *vg, int slot);
+
+/**
+ * @brief Starts reading the current version.
+ *
+ * The returned snapshot stays valid and unchanged until graph_versioned_read_end
+ * is called with the same slot, however many versions are committed meanwhile.
+ * No locks are taken.
+ *
+ * @param vg The versioned graph.
+ * @param slot The slot of the reader.
+ * @return The current version of the edges, or NULL on failure.
+ */
+const GraphCSR *graph_versioned_read_begin(VersionedGraph *vg, int slot);
+
+/**
+ * @brief Stops reading the snapshot returned by graph_versioned_read_begin.
+ *
+ * @param vg The versioned graph.
+ * @param slot The slot of the reader.
+ */
+void graph_versioned_read_end(VersionedGraph *vg, int slot);
+
+/**
+ * @brief Applies a batch of edge changes as a new version.
+ *
+ * Edges are given as pairs of nodes, {a0, b0, a1, b1, ...}. Removals are
+ * applied after insertions. Concurrent writers are serialized with a spin
+ * lock, and versions that no reader can see any longer are freed.
+ *
+ * @param vg The versioned graph.
+ * @param inserts The edges to insert.
+ * @param no_of_inserts The number of edges to insert.
+ * @param removes The edges to remove.
+ * @param no_of_removes The number of edges to remove.
+ * @return true on success, false on failure, in which case no version is published.
+ */
+bool graph_versioned_commit(VersionedGraph *vg, const int *inserts, int no_of_inserts,
+                            const int *removes, int no_of_removes);
+
+/**
+ * @brief Returns the number of committed versions.
+ *
+ * @param vg The versioned graph.
+ * @return The number of the current version, starting at 0.
+ */
+long long graph_versioned_version(VersionedGraph *vg);
+
+/**
+ * @brief Destroys the versioned graph and all its versions.
+ *
+ * No reader may be reading when it is destroyed.
+ *
+ * @param vg The versioned graph to destroy.
+ */
+void graph_versioned_destroy(VersionedGraph *vg);
+
 /**
  * @brief Destroys the graph, freeing all allocated resources.
  *
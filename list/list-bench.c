@@ -0,0 +1,388 @@
+/*
+ * File:         list-bench.c
+ * Description:  Benchmarks of the list module.
+ *
+ *               Build with optimizations, for example:
+ *               gcc -O2 list-bench.c list.c
+ *
+ * Author:       Emil Engvall
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "list.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+
+double now(void);
+void bench_insert_traverse(int n, int rounds);
+void *counting_alloc(void *ctx, size_t size);
+void counting_free(void *ctx, void *ptr, size_t size);
+void bench_pool(int messages, int backlog);
+long resident_kb(void);
+void run_scan(const char *kind, int n, int rounds);
+void bench_unrolled(int n, int rounds);
+void bench_owned(int messages, int backlog);
+void bench_splice(int lists, int batch, int rounds);
+int compare_strings(const void *a, const void *b);
+List *make_random_list(int n, bool unrolled);
+void bench_sort(int n);
+
+
+int main(void)
+{
+    bench_insert_traverse(1000000, 5);
+    bench_pool(20000000, 1000);
+    bench_unrolled(5000000, 10);
+    bench_owned(10000000, 1000);
+    bench_splice(100, 1000, 100);
+    bench_sort(2000000);
+    return 0;
+}
+
+// Returns a monotonic time in seconds.
+double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Measures inserting n short strings, traversing them and destroying the list.
+void bench_insert_traverse(int n, int rounds)
+{
+    char (*values)[32] = malloc((size_t)n * sizeof(*values));
+    for (int i = 0; i < n; i++) {
+        snprintf(values[i], sizeof(values[i]), "message-%d", i);
+    }
+    double insert = 0.0;
+    double traverse = 0.0;
+    double destroy = 0.0;
+    size_t total = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        List *lst = list_create();
+        double start = now();
+        for (int i = 0; i < n; i++) {
+            list_insert(list_end(lst), values[i]);
+        }
+        insert += now() - start;
+
+        start = now();
+        for (ListPos pos = list_first(lst); !list_pos_equal(pos, list_end(lst)); pos = list_next(pos)) {
+            total += list_inspect_length(pos) + (unsigned char)list_inspect(pos)[0];
+        }
+        traverse += now() - start;
+
+        start = now();
+        list_destroy(lst);
+        destroy += now() - start;
+    }
+
+    printf("list with %d short strings, average of %d rounds\n", n, rounds);
+    printf("%-10s %12s\n", "operation", "ns/element");
+    printf("%-10s %12.1f\n", "insert", insert / rounds / n * 1e9);
+    printf("%-10s %12.1f\n", "traverse", traverse / rounds / n * 1e9);
+    printf("%-10s %12.1f\n", "destroy", destroy / rounds / n * 1e9);
+    if (total == 0) {
+        printf("error: empty strings\n");
+    }
+    free(values);
+}
+
+// Allocates with malloc and counts the calls in *ctx.
+void *counting_alloc(void *ctx, size_t size)
+{
+    (*(long *)ctx)++;
+    return malloc(size);
+}
+
+// Frees a block allocated by counting_alloc.
+void counting_free(void *ctx, void *ptr, size_t size)
+{
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+// Passes messages through a list used as a queue holding about backlog
+// messages, with nodes from malloc and from a pool.
+void bench_pool(int messages, int backlog)
+{
+    const char *values[] = {"ping", "GET /index.html", "user=42;action=login", "ack"};
+
+    printf("\nPassing %d messages through a list used as a queue\n", messages);
+    printf("%-8s %14s %12s\n", "nodes", "malloc calls", "Mmsg/s");
+
+    for (int pooled = 0; pooled < 2; pooled++) {
+        long mallocs = 0;
+        ListAllocator counting = {counting_alloc, counting_free, &mallocs};
+        ListPool *pool = pooled ? list_pool_create(&counting) : NULL;
+        ListAllocator allocator = pooled ? list_pool_allocator(pool) : counting;
+        List *lst = list_create_with_allocator(&allocator);
+
+        double start = now();
+        for (int i = 0; i < messages; i++) {
+            list_insert(list_end(lst), values[i % 4]);
+            if (i >= backlog) {
+                list_remove(list_first(lst));
+            }
+        }
+        list_destroy(lst);
+        list_pool_destroy(pool);
+        double elapsed = now() - start;
+
+        printf("%-8s %14ld %12.1f\n", pooled ? "pool" : "malloc", mallocs, messages / elapsed * 1e-6);
+    }
+}
+
+// Returns the resident set size of the process in kilobytes, or -1 if unknown.
+long resident_kb(void)
+{
+    long pages = -1;
+    long resident = -1;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f != NULL) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+            resident = -1;
+        }
+        fclose(f);
+    }
+    return resident < 0 ? -1 : resident * 4;
+}
+
+// Builds a list of the given kind with n short strings, scans it and prints
+// the results.
+void run_scan(const char *kind, int n, int rounds)
+{
+    long base = resident_kb();
+    List *lst = kind[0] == 'u' ? list_create_unrolled() : list_create();
+    char value[32];
+
+    double start = now();
+    for (int i = 0; i < n; i++) {
+        snprintf(value, sizeof(value), "message-%d", i);
+        list_insert(list_end(lst), value);
+    }
+    double insert = now() - start;
+    long rss = resident_kb() - base;
+
+    size_t total = 0;
+    start = now();
+    for (int r = 0; r < rounds; r++) {
+        for (ListPos pos = list_first(lst); !list_pos_equal(pos, list_end(lst)); pos = list_next(pos)) {
+            total += list_inspect_length(pos) + (unsigned char)list_inspect(pos)[0];
+        }
+    }
+    double scan = (now() - start) / rounds;
+
+    printf("%-10s %14.1f %12.2f %14.1f\n", kind, insert / n * 1e9, scan / n * 1e9, rss * 1024.0 / n);
+    if (total == 0) {
+        printf("error: empty strings\n");
+    }
+    list_destroy(lst);
+}
+
+// Compares scanning a linked and an unrolled list. Every kind runs in a
+// process of its own, so that the memory use of one does not hide the other.
+void bench_unrolled(int n, int rounds)
+{
+    const char *kinds[] = {"linked", "unrolled"};
+
+    printf("\nScanning a list of %d short strings\n", n);
+    printf("%-10s %14s %12s %14s\n", "list", "insert (ns)", "scan (ns)", "bytes/value");
+    fflush(stdout);
+
+    for (int k = 0; k < 2; k++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            run_scan(kinds[k], n, rounds);
+            fflush(stdout);
+            _exit(0);
+        }
+        if (pid > 0) {
+            waitpid(pid, NULL, 0);
+        }
+    }
+}
+
+// Passes malloc'd messages through a list used as a queue holding about
+// backlog messages, copying them in and out as queue_enqueue and
+// queue_dequeue used to, or moving them with list_insert_owned and list_take
+// through a list with malloc'd or pooled nodes.
+void bench_owned(int messages, int backlog)
+{
+    const char *values[] = {"ping", "GET /index.html", "user=42;action=login", "ack"};
+
+    printf("\nPassing %d malloc'd messages through a list used as a queue\n", messages);
+    printf("%-14s %12s\n", "values", "Mmsg/s");
+
+    for (int kind = 0; kind < 3; kind++) {
+        bool owned = kind > 0;
+        List *lst = kind == 2 ? list_create_pooled() : list_create();
+        size_t total = 0;
+
+        double start = now();
+        for (int i = 0; i < messages; i++) {
+            const char *text = values[i % 4];
+            size_t len = strlen(text);
+            char *message = malloc(len + 1);
+            memcpy(message, text, len + 1);
+            if (owned) {
+                ListPos end = list_end(lst);
+                list_insert_owned(&end, message);
+            } else {
+                list_insert(list_end(lst), message);
+                free(message);
+            }
+
+            if (i >= backlog) {
+                ListPos first = list_first(lst);
+                char *value;
+                if (owned) {
+                    value = list_take(first, NULL);
+                } else {
+                    len = list_inspect_length(first);
+                    value = malloc(len + 1);
+                    memcpy(value, list_inspect(first), len + 1);
+                    list_remove(first);
+                }
+                total += (unsigned char)value[0];
+                free(value);
+            }
+        }
+        double elapsed = now() - start;
+        list_destroy(lst);
+
+        const char *names[] = {"copied", "owned", "owned, pooled"};
+        printf("%-14s %12.1f\n", names[kind], messages / elapsed * 1e-6);
+        if (total == 0) {
+            printf("error: empty strings\n");
+        }
+    }
+}
+
+// Gathers batches of values from many lists into one, element by element
+// with list_insert and list_remove, or with list_concat.
+void bench_splice(int lists, int batch, int rounds)
+{
+    printf("\nMoving %d batches of %d values into one list, %d rounds\n", lists, batch, rounds);
+    printf("%-14s %12s\n", "method", "ns/value");
+
+    for (int concat = 0; concat < 2; concat++) {
+        List **sources = malloc(lists * sizeof(List *));
+        for (int i = 0; i < lists; i++) {
+            sources[i] = list_create();
+        }
+        List *global = list_create();
+        double elapsed = 0.0;
+
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < lists; i++) {
+                for (int j = 0; j < batch; j++) {
+                    list_insert(list_end(sources[i]), "connection-data");
+                }
+            }
+
+            double start = now();
+            for (int i = 0; i < lists; i++) {
+                if (concat) {
+                    list_concat(global, sources[i]);
+                } else {
+                    ListPos pos = list_first(sources[i]);
+                    while (!list_pos_equal(pos, list_end(sources[i]))) {
+                        list_insert(list_end(global), list_inspect(pos));
+                        pos = list_remove(pos);
+                    }
+                }
+            }
+            elapsed += now() - start;
+
+            while (!list_is_empty(global)) {
+                list_remove(list_first(global));
+            }
+        }
+
+        printf("%-14s %12.2f\n", concat ? "list_concat" : "insert+remove",
+               elapsed / rounds / ((double)lists * batch) * 1e9);
+        for (int i = 0; i < lists; i++) {
+            list_destroy(sources[i]);
+        }
+        free(sources);
+        list_destroy(global);
+    }
+}
+
+// Compares two strings through pointers to them, for qsort.
+int compare_strings(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Creates a list of n random lowercase strings of 8 to 23 characters,
+// the same ones on every call.
+List *make_random_list(int n, bool unrolled)
+{
+    srand(1);
+    List *lst = unrolled ? list_create_unrolled() : list_create();
+    char value[24];
+    for (int i = 0; i < n; i++) {
+        int length = 8 + rand() % 16;
+        for (int j = 0; j < length; j++) {
+            value[j] = 'a' + rand() % 26;
+        }
+        value[length] = '\0';
+        list_insert(list_end(lst), value);
+    }
+    return lst;
+}
+
+// Compares list_sort and list_radix_sort with copying the values into an
+// array, sorting it with qsort and building a new list from it.
+void bench_sort(int n)
+{
+    printf("\nSorting a list of %d random strings (s)\n", n);
+    printf("%-10s %14s %12s %12s\n", "list", "qsort+rebuild", "list_sort", "radix_sort");
+
+    for (int unrolled = 0; unrolled < 2; unrolled++) {
+        List *lst = make_random_list(n, unrolled);
+        double start = now();
+        char **values = malloc(n * sizeof(char *));
+        int i = 0;
+        for (ListPos pos = list_first(lst); !list_pos_equal(pos, list_end(lst)); pos = list_next(pos)) {
+            size_t len = list_inspect_length(pos);
+            values[i] = malloc(len + 1);
+            memcpy(values[i], list_inspect(pos), len + 1);
+            i++;
+        }
+        list_destroy(lst);
+        qsort(values, n, sizeof(char *), compare_strings);
+        lst = unrolled ? list_create_unrolled() : list_create();
+        for (i = 0; i < n; i++) {
+            list_insert(list_end(lst), values[i]);
+            free(values[i]);
+        }
+        free(values);
+        double copied = now() - start;
+        list_destroy(lst);
+
+        lst = make_random_list(n, unrolled);
+        start = now();
+        list_sort(lst, strcmp);
+        double merged = now() - start;
+        list_destroy(lst);
+
+        lst = make_random_list(n, unrolled);
+        start = now();
+        list_radix_sort(lst);
+        double radix = now() - start;
+        list_destroy(lst);
+
+        printf("%-10s %14.3f %12.3f %12.3f\n", unrolled ? "unrolled" : "linked", copied, merged, radix);
+    }
+}
@@ -0,0 +1,494 @@
+/*
+ * File:         list-test.c
+ * Description:  A program to test the list module.
+ * Author:       Emil Engvall
+ */
+
+#include "list.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+
+void print_test_result(bool condition, const char *test_name);
+void test_insert_remove(void);
+void *counting_alloc(void *ctx, size_t size);
+void counting_free(void *ctx, void *ptr, size_t size);
+void test_pool(void);
+void test_unrolled(void);
+void test_owned(void);
+List *make_list(List *lst, const char *values);
+bool list_equals(List *lst, const char *values);
+void test_splice(void);
+int compare_strings(const void *a, const void *b);
+int compare_first(const char *a, const char *b);
+void test_sort(void);
+
+
+int main(void)
+{
+    test_insert_remove();
+    test_pool();
+    test_unrolled();
+    test_owned();
+    test_splice();
+    test_sort();
+    return 0;
+}
+
+// Print the result of a test.
+void print_test_result(bool condition, const char *test_name)
+{
+    printf("%s: %s\n", condition ? "PASS" : "FAIL", test_name);
+}
+
+// Insert values at both ends and in the middle, then remove some of them.
+void test_insert_remove(void)
+{
+    List *lst = list_create();
+    bool condition = list_is_empty(lst) && list_inspect(list_end(lst)) == NULL
+        && list_inspect_length(list_end(lst)) == 0;
+
+    list_insert(list_end(lst), "b");
+    list_insert(list_first(lst), "");
+    ListPos pos = list_insert(list_end(lst), "dddd");
+    list_insert(pos, "ccc");
+
+    const char *expected[] = {"", "b", "ccc", "dddd"};
+    int i = 0;
+    for (pos = list_first(lst); !list_pos_equal(pos, list_end(lst)); pos = list_next(pos)) {
+        condition = condition && i < 4 && strcmp(list_inspect(pos), expected[i]) == 0
+            && list_inspect_length(pos) == strlen(expected[i]);
+        i++;
+    }
+    condition = condition && i == 4 && !list_is_empty(lst);
+    print_test_result(condition, "list_insert and list_inspect");
+
+    pos = list_remove(list_next(list_first(lst)));
+    pos = list_remove(pos);
+    condition = strcmp(list_inspect(pos), "dddd") == 0
+        && list_pos_equal(list_remove(list_end(lst)), list_end(lst))
+        && list_pos_equal(list_prev(pos), list_first(lst));
+    list_remove(list_first(lst));
+    list_remove(list_first(lst));
+    condition = condition && list_is_empty(lst);
+    print_test_result(condition, "list_remove");
+
+    list_destroy(lst);
+}
+
+// Allocates with malloc and counts the blocks in use in *ctx.
+void *counting_alloc(void *ctx, size_t size)
+{
+    (*(int *)ctx)++;
+    return malloc(size);
+}
+
+// Frees a block allocated by counting_alloc.
+void counting_free(void *ctx, void *ptr, size_t size)
+{
+    (void)size;
+    (*(int *)ctx)--;
+    free(ptr);
+}
+
+// Check that a pool reuses released blocks and frees everything, including
+// values too large for its size classes.
+void test_pool(void)
+{
+    int blocks = 0;
+    ListAllocator counting = {counting_alloc, counting_free, &blocks};
+    ListPool *pool = list_pool_create(&counting);
+    ListAllocator allocator = list_pool_allocator(pool);
+    List *lst = list_create_with_allocator(&allocator);
+
+    char large[1000];
+    memset(large, 'x', sizeof(large) - 1);
+    large[sizeof(large) - 1] = '\0';
+
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 1000; i++) {
+            list_insert(list_end(lst), i % 100 == 0 ? large : "message");
+        }
+        while (!list_is_empty(lst)) {
+            list_remove(list_first(lst));
+        }
+    }
+    list_insert(list_end(lst), "last");
+    list_insert(list_end(lst), large);
+
+    // One slab holds all small nodes, the rest are the large ones in use
+    bool condition = blocks == 1 + 1 && strcmp(list_inspect(list_first(lst)), "last") == 0;
+    list_destroy(lst);
+    list_pool_destroy(pool);
+    condition = condition && blocks == 0;
+    print_test_result(condition, "list_pool_allocator");
+
+    lst = list_create_with_allocator(&counting);
+    list_insert(list_end(lst), "a");
+    list_insert(list_end(lst), "b");
+    condition = blocks == 2;
+    list_remove(list_first(lst));
+    condition = condition && blocks == 1;
+    list_destroy(lst);
+    print_test_result(condition && blocks == 0, "list_create_with_allocator");
+
+    // A list owning its pool, as made by list_create_pooled but with a
+    // counting backing allocator, releases everything in list_destroy
+    pool = list_pool_create(&counting);
+    allocator = list_pool_allocator(pool);
+    lst = list_create_with_allocator(&allocator);
+    lst->own_pool = pool;
+    for (int i = 0; i < 1000; i++) {
+        list_insert(list_end(lst), i % 100 == 0 ? large : "message");
+    }
+    condition = blocks == 1 + 10;
+    int i = 0;
+    for (ListPos pos = list_first(lst); !list_pos_equal(pos, list_end(lst)); pos = list_next(pos)) {
+        condition = condition && strcmp(list_inspect(pos), i % 100 == 0 ? large : "message") == 0;
+        i++;
+    }
+    list_destroy(lst);
+    condition = condition && i == 1000 && blocks == 0;
+
+    lst = list_create_pooled();
+    for (i = 0; i < 1000; i++) {
+        list_insert(list_end(lst), i % 100 == 0 ? large : "message");
+    }
+    i = 0;
+    for (ListPos pos = list_first(lst); !list_pos_equal(pos, list_end(lst)); pos = list_next(pos)) {
+        condition = condition && strcmp(list_inspect(pos), i % 100 == 0 ? large : "message") == 0;
+        i++;
+    }
+    condition = condition && i == 1000 && lst->own_pool != NULL;
+    list_destroy(lst);
+    print_test_result(condition, "list_create_pooled");
+}
+
+// Apply the same random inserts and removes to an unrolled list and to an
+// array, and compare them in both directions.
+void test_unrolled(void)
+{
+    int n = 0;
+    int capacity = 20000;
+    char **model = malloc(capacity * sizeof(char *));
+    char large[2000];
+    memset(large, 'y', sizeof(large) - 1);
+    large[sizeof(large) - 1] = '\0';
+
+    List *lst = list_create_unrolled();
+    srand(7);
+    bool condition = list_is_empty(lst);
+    for (int step = 0; step < 20000; step++) {
+        int index = n > 0 ? rand() % (n + 1) : 0;
+        ListPos pos = list_first(lst);
+        for (int i = 0; i < index; i++) {
+            pos = list_next(pos);
+        }
+
+        if (rand() % 3 == 0 && index < n) {
+            pos = list_remove(pos);
+            if (model[index] != large) {
+                free(model[index]);
+            }
+            memmove(&model[index], &model[index + 1], (n - index - 1) * sizeof(char *));
+            n--;
+            condition = condition && (index == n ? list_pos_equal(pos, list_end(lst))
+                                                 : strcmp(list_inspect(pos), model[index]) == 0);
+        } else {
+            char value[32];
+            snprintf(value, sizeof(value), "v%d", step);
+            const char *inserted = step % 500 == 0 ? large : value;
+            pos = list_insert(pos, inserted);
+            memmove(&model[index + 1], &model[index], (n - index) * sizeof(char *));
+            model[index] = step % 500 == 0 ? large : strcpy(malloc(32), value);
+            n++;
+            condition = condition && strcmp(list_inspect(pos), inserted) == 0;
+        }
+    }
+
+    int i = 0;
+    for (ListPos pos = list_first(lst); !list_pos_equal(pos, list_end(lst)); pos = list_next(pos)) {
+        condition = condition && i < n && strcmp(list_inspect(pos), model[i]) == 0
+            && list_inspect_length(pos) == strlen(model[i]);
+        i++;
+    }
+    condition = condition && i == n;
+    for (ListPos pos = list_prev(list_end(lst)); !list_pos_equal(pos, list_end(lst)); pos = list_prev(pos)) {
+        i--;
+        condition = condition && i >= 0 && strcmp(list_inspect(pos), model[i]) == 0;
+    }
+    condition = condition && i == 0;
+    print_test_result(condition, "list_create_unrolled");
+
+    list_destroy(lst);
+    for (int j = 0; j < n; j++) {
+        if (model[j] != large) {
+            free(model[j]);
+        }
+    }
+    free(model);
+}
+
+// Move malloc'd strings into linked, pooled and unrolled lists and take
+// them out again, in order and from the middle.
+void test_owned(void)
+{
+    List *lists[] = {list_create(), list_create_pooled(), list_create_unrolled()};
+    bool condition = true;
+
+    for (int k = 0; k < 3; k++) {
+        List *lst = lists[k];
+        char buffer[32];
+        for (int i = 0; i < 100; i++) {
+            snprintf(buffer, sizeof(buffer), "value-%d", i);
+            char *value = malloc(strlen(buffer) + 1);
+            strcpy(value, buffer);
+            ListPos pos = list_end(lst);
+            bool inserted = list_insert_owned(&pos, value);
+            condition = condition && inserted && strcmp(list_inspect(pos), buffer) == 0
+                && list_inspect_length(pos) == strlen(buffer);
+        }
+
+        // Take every third value from the middle
+        ListPos next;
+        ListPos pos = list_first(lst);
+        for (int i = 0; i < 100; i++) {
+            if (i % 3 == 1) {
+                char *value = list_take(pos, &next);
+                snprintf(buffer, sizeof(buffer), "value-%d", i);
+                condition = condition && value != NULL && strcmp(value, buffer) == 0;
+                free(value);
+                pos = next;
+            } else {
+                pos = list_next(pos);
+            }
+        }
+        condition = condition && list_take(list_end(lst), &next) == NULL
+            && list_pos_equal(next, list_end(lst));
+
+        // Take the rest from the front
+        for (int i = 0; i < 100; i++) {
+            if (i % 3 != 1) {
+                char *value = list_take(list_first(lst), NULL);
+                snprintf(buffer, sizeof(buffer), "value-%d", i);
+                condition = condition && value != NULL && strcmp(value, buffer) == 0;
+                free(value);
+            }
+        }
+        condition = condition && list_is_empty(lst);
+
+        // Mix owned and copied values, and leave some for list_destroy
+        for (int i = 0; i < 4; i++) {
+            char *value = malloc(8);
+            strcpy(value, "owned");
+            ListPos end = list_end(lst);
+            list_insert_owned(&end, value);
+            list_insert(list_end(lst), "copied");
+        }
+        // In an unrolled list the new value takes the slot of the old first one
+        ListPos front = list_first(lst);
+        char *head = malloc(8);
+        strcpy(head, "head");
+        bool inserted = list_insert_owned(&front, head);
+        condition = condition && inserted && strcmp(list_inspect(front), "head") == 0
+            && list_pos_equal(front, list_first(lst));
+        front = list_remove(front);
+        ListPos second = list_remove(front);
+        condition = condition && strcmp(list_inspect(second), "copied") == 0
+            && strcmp(list_inspect(list_next(second)), "owned") == 0
+            && list_inspect_length(list_next(second)) == 5;
+        list_destroy(lst);
+    }
+    print_test_result(condition, "list_insert_owned and list_take");
+}
+
+// Appends one single-character value per character of values to a list.
+List *make_list(List *lst, const char *values)
+{
+    for (const char *c = values; *c != '\0'; c++) {
+        char value[2] = {*c, '\0'};
+        list_insert(list_end(lst), value);
+    }
+    return lst;
+}
+
+// Checks that a list holds one single-character value per character of
+// values, in both directions.
+bool list_equals(List *lst, const char *values)
+{
+    size_t n = strlen(values);
+    size_t i = 0;
+    for (ListPos pos = list_first(lst); !list_pos_equal(pos, list_end(lst)); pos = list_next(pos)) {
+        if (i >= n || list_inspect(pos)[0] != values[i]) {
+            return false;
+        }
+        i++;
+    }
+    for (ListPos pos = list_prev(list_end(lst)); i > 0; pos = list_prev(pos)) {
+        i--;
+        if (list_inspect(pos)[0] != values[i]) {
+            return false;
+        }
+    }
+    return i == 0 && n == 0 ? list_is_empty(lst) : true;
+}
+
+// Move ranges between and within lists of every kind, and concatenate and
+// split them.
+void test_splice(void)
+{
+    // Relinking between linked lists, with an owned value in the range
+    List *a = make_list(list_create(), "abcdef");
+    List *b = make_list(list_create(), "xyz");
+    char *owned = malloc(2);
+    strcpy(owned, "o");
+    ListPos third = list_next(list_next(list_first(a)));
+    list_insert_owned(&third, owned);
+    ListPos first = list_next(list_first(a));
+    ListPos last = list_prev(list_end(a));
+    ListPos moved = list_next(list_first(b));
+    bool condition = list_splice(&moved, first, last) && list_equals(a, "af") && list_equals(b, "xbocdeyz")
+        && strcmp(list_inspect(moved), "b") == 0 && moved.list == b;
+
+    // Within one list, and empty ranges
+    moved = list_first(b);
+    condition = condition && list_splice(&moved, list_prev(list_end(b)), list_end(b))
+        && list_equals(b, "zxbocdey") && strcmp(list_inspect(moved), "z") == 0;
+    moved = list_end(a);
+    condition = condition && !list_splice(&moved, list_first(b), list_first(b))
+        && list_pos_equal(moved, list_end(a));
+
+    list_concat(a, b);
+    condition = condition && list_equals(a, "afzxbocdey") && list_equals(b, "");
+    print_test_result(condition, "list_splice and list_concat of linked lists");
+
+    List *rest = list_split_at(list_next(list_next(list_next(list_first(a)))));
+    condition = list_equals(a, "afz") && list_equals(rest, "xbocdey");
+    List *none = list_split_at(list_end(a));
+    List *all = list_split_at(list_first(rest));
+    condition = condition && list_equals(a, "afz") && list_equals(none, "")
+        && list_equals(rest, "") && list_equals(all, "xbocdey");
+    list_destroy(a);
+    list_destroy(b);
+    list_destroy(rest);
+    list_destroy(none);
+    list_destroy(all);
+
+    // Copying between lists whose nodes cannot be shared
+    List *pooled = make_list(list_create_pooled(), "pqrs");
+    List *unrolled = make_list(list_create_unrolled(), "");
+    for (int i = 0; i < 100; i++) {
+        make_list(unrolled, "0123456789");
+    }
+    List *linked = make_list(list_create(), "ab");
+    moved = list_next(list_first(linked));
+    condition = condition && list_splice(&moved, list_next(list_first(pooled)), list_end(pooled))
+        && list_equals(pooled, "p") && list_equals(linked, "aqrsb")
+        && strcmp(list_inspect(moved), "q") == 0;
+
+    first = list_first(unrolled);
+    for (int i = 0; i < 995; i++) {
+        first = list_next(first);
+    }
+    List *tail = list_split_at(first);
+    list_concat(pooled, tail);
+    condition = condition && list_equals(tail, "");
+    list_destroy(tail);
+    // The first moved value takes the slot of the old first value
+    moved = list_first(unrolled);
+    condition = condition && list_splice(&moved, list_first(linked), list_end(linked))
+        && list_pos_equal(moved, list_first(unrolled)) && list_equals(pooled, "p56789") && list_equals(linked, "")
+        && strcmp(list_inspect(moved), "a") == 0 && list_inspect_length(moved) == 1;
+    size_t n = 0;
+    for (ListPos pos = list_first(unrolled); !list_pos_equal(pos, list_end(unrolled)); pos = list_next(pos)) {
+        n++;
+    }
+    condition = condition && n == 1000 && strcmp(list_inspect(list_prev(list_end(unrolled))), "4") == 0;
+    print_test_result(condition, "list_split_at and copying list_splice");
+
+    list_destroy(pooled);
+    list_destroy(unrolled);
+    list_destroy(linked);
+}
+
+// Compares two strings through pointers to them, for qsort.
+int compare_strings(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Compares only the first characters of two strings.
+int compare_first(const char *a, const char *b)
+{
+    return (unsigned char)a[0] - (unsigned char)b[0];
+}
+
+// Sort lists of every kind with both sorts and compare the result with
+// qsort. The values have many duplicates and shared prefixes, some long,
+// and bytes above 127.
+void test_sort(void)
+{
+    const char *alphabet = "ab\xe5z";
+    int n = 3000;
+    char **values = malloc(n * sizeof(char *));
+    for (int i = 0; i < n; i++) {
+        int length = rand() % 4 == 0 ? 100 + rand() % 50 : rand() % 8;
+        values[i] = malloc(length + 1);
+        for (int j = 0; j < length; j++) {
+            values[i][j] = j < 100 && length >= 100 ? 'p' : alphabet[rand() % 4];
+        }
+        values[i][length] = '\0';
+    }
+    char **expected = malloc(n * sizeof(char *));
+    memcpy(expected, values, n * sizeof(char *));
+    qsort(expected, n, sizeof(char *), compare_strings);
+
+    bool condition = true;
+    for (int k = 0; k < 6; k++) {
+        List *lst = k % 3 == 0 ? list_create() : k % 3 == 1 ? list_create_pooled() : list_create_unrolled();
+        for (int i = 0; i < n; i++) {
+            if (i % 2 == 0) {
+                char *owned = malloc(strlen(values[i]) + 1);
+                strcpy(owned, values[i]);
+                ListPos end = list_end(lst);
+                list_insert_owned(&end, owned);
+            } else {
+                list_insert(list_end(lst), values[i]);
+            }
+        }
+        condition = condition && (k < 3 ? list_sort(lst, strcmp) : list_radix_sort(lst));
+
+        int i = 0;
+        for (ListPos pos = list_first(lst); !list_pos_equal(pos, list_end(lst)); pos = list_next(pos)) {
+            condition = condition && i < n && strcmp(list_inspect(pos), expected[i]) == 0;
+            i++;
+        }
+        for (ListPos pos = list_prev(list_end(lst)); i > 0; pos = list_prev(pos)) {
+            i--;
+            condition = condition && strcmp(list_inspect(pos), expected[i]) == 0;
+        }
+        list_destroy(lst);
+    }
+
+    // Both sorts are stable, and empty lists are sorted
+    List *lst = make_list(list_create(), "b");
+    list_insert(list_end(lst), "a1");
+    list_insert(list_end(lst), "c");
+    list_insert(list_end(lst), "a0");
+    list_sort(lst, compare_first);
+    ListPos pos = list_first(lst);
+    condition = condition && strcmp(list_inspect(pos), "a1") == 0
+        && strcmp(list_inspect(list_next(pos)), "a0") == 0;
+    list_destroy(lst);
+    List *empty = list_create_unrolled();
+    condition = condition && list_sort(empty, strcmp) && list_radix_sort(empty) && list_is_empty(empty);
+    list_destroy(empty);
+    print_test_result(condition, "list_sort and list_radix_sort");
+
+    for (int i = 0; i < n; i++) {
+        free(values[i]);
+    }
+    free(values);
+    free(expected);
+}
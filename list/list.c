@@ -13,85 +13,1072 @@
 #include "list.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+
+/* Length stored in the sentinel node, which has no value */
+#define HEAD_LENGTH SIZE_MAX
+
+/* Flag in the length of a node whose value is a pointer to an owned string */
+#define OWNED_FLAG (SIZE_MAX - SIZE_MAX / 2)
+
+/* Size classes of a pool: multiples of POOL_GRANULE up to POOL_MAX_BLOCK bytes */
+#define POOL_GRANULE 16
+#define POOL_MAX_BLOCK 256
+#define POOL_SLAB_SIZE 65536
+
+/* Number of values in a block of an unrolled list, and the alignment and
+   size of an ordinary block. Every block is aligned to BLOCK_SIZE, so the
+   block of a slot is found by rounding its address down. */
+#define BLOCK_SLOTS 40
+#define BLOCK_SIZE 1024
+#define BLOCK_DATA ((int)(BLOCK_SIZE - sizeof(struct list_block)))
+
+/* Number of ordinary blocks carved from a chunk */
+#define CHUNK_BLOCKS 64
+
+/* Buckets of a radix sort smaller than this are sorted by insertion */
+#define RADIX_CUTOFF 32
+
+/* How many values ahead a radix sort prefetches */
+#define RADIX_PREFETCH 16
+
+/* Buckets nested deeper than this are merge sorted, to bound the stack */
+#define RADIX_MAX_LEVELS 64
+
+/**
+ * Value of a list being sorted as an array, with its node in a linked list.
+ */
+struct sort_item
+{
+    const char *value;  /* The string */
+    struct node *node;  /* The node, or NULL in an unrolled list */
+};
+
+/**
+ * Position and length of a value in the data of a block.
+ */
+struct list_slot
+{
+    int offset;  /* Offset of the string in the data */
+    int length;  /* Length of the string without the terminator */
+};
+
+/**
+ * Block of an unrolled list. The strings of the values are appended to the
+ * data in insertion order, and the slots list them in list order. The
+ * strings of removed values stay behind as garbage until the block is
+ * compacted. Only the sentinel block is ever empty.
+ */
+struct list_block
+{
+    struct list_block *next;             /* Pointer to the next block */
+    struct list_block *prev;             /* Pointer to the previous block */
+    int count;                           /* Number of values */
+    int used;                            /* Bytes of the data in use, including garbage */
+    int garbage;                         /* Bytes of the data held by removed values */
+    int capacity;                        /* Size of the data */
+    struct list_slot slots[BLOCK_SLOTS]; /* The values in list order */
+    char data[];                         /* The null-terminated strings */
+};
+
+/**
+ * Chunk of ordinary blocks of an unrolled list. Carving the blocks from
+ * larger chunks avoids the padding of aligning every block on its own.
+ */
+struct list_chunk
+{
+    struct list_chunk *next;  /* The previously allocated chunk */
+    char *blocks;             /* CHUNK_BLOCKS blocks aligned to BLOCK_SIZE */
+};
+
+/**
+ * Header of a slab of a pool, followed by the blocks.
+ */
+struct list_pool_slab
+{
+    struct list_pool_slab *next;  /* The previously allocated slab */
+    size_t size;                  /* Size of the slab including the header */
+};
+
+struct list_pool
+{
+    ListAllocator backing;                                 /* Allocator of slabs and large blocks */
+    struct list_pool_slab *slabs;                          /* The newest slab */
+    char *bump;                                            /* Next unused byte of the newest slab */
+    char *bump_end;                                        /* End of the newest slab */
+    void *free_blocks[POOL_MAX_BLOCK / POOL_GRANULE + 1];  /* Released blocks per size class */
+    size_t large;                                          /* Number of large blocks handed out */
+};
 
 /* Declaration of internal functions */
-static char *clone_string(const char *in);
-static struct node *make_node(const char *value);
+static void *backing_alloc(const ListAllocator *allocator, size_t size);
+static void backing_free(const ListAllocator *allocator, void *ptr, size_t size);
+static void *pool_alloc(void *ctx, size_t size);
+static void pool_free(void *ctx, void *ptr, size_t size);
+static size_t node_size(size_t length);
+static size_t node_block_size(const struct node *node);
+static const char *node_value(const struct node *node);
+static struct node *make_node(List *lst, const char *value);
+static void free_node(List *lst, struct node *node);
+static struct list_block *make_block(List *lst, int capacity, struct list_block *after);
+static void free_block(List *lst, struct list_block *block);
+static struct list_block *block_of(ListPos pos);
+static bool block_fits(const struct list_block *block, size_t length);
+static void block_compact(struct list_block *block);
+static void block_move(struct list_block *from, int first, struct list_block *to);
+static ListPos link_node(ListPos pos, struct node *node);
+static bool block_insert(ListPos *pos, const char *value);
+static bool insert_value(ListPos *pos, const char *value);
+static bool same_nodes(const List *a, const List *b);
+static bool splice_copy(ListPos *dst_pos, ListPos src_first, ListPos src_last);
+static struct node *merge_runs(struct node *a, struct node *b, int (*cmp)(const char *, const char *));
+static size_t list_length(List *lst);
+static struct sort_item *extract_items(List *lst, size_t n);
+static bool apply_items(List *lst, const struct sort_item *items, size_t n);
+static void merge_sort_items(struct sort_item *items, struct sort_item *temp, size_t n,
+                             int (*cmp)(const char *, const char *));
+static void insertion_sort_items(struct sort_item *items, size_t n, size_t depth);
+static void radix_sort_items(struct sort_item *items, struct sort_item *temp, unsigned char *oracle,
+                             size_t n, size_t depth, int level);
+static ListPos block_remove(ListPos pos);
 
 
 /* ---------------------- Internal functions ---------------------- */
 
 /**
- * @brief Clones a string.
+ * @brief Allocates a block with an allocator, or with malloc if it has no alloc.
+ */
+static void *backing_alloc(const ListAllocator *allocator, size_t size)
+{
+    return allocator->alloc != NULL ? allocator->alloc(allocator->ctx, size) : malloc(size);
+}
+
+
+/**
+ * @brief Frees a block allocated by backing_alloc.
+ */
+static void backing_free(const ListAllocator *allocator, void *ptr, size_t size)
+{
+    if (allocator->alloc != NULL) {
+        allocator->free(allocator->ctx, ptr, size);
+    } else {
+        free(ptr);
+    }
+}
+
+
+/**
+ * @brief Takes a block from a pool.
+ *
+ * Uses a released block of the same size class if there is one, and
+ * otherwise carves a new one from the newest slab.
+ *
+ * @param[in] ctx The pool.
+ * @param[in] size The size of the block.
+ * @return A pointer to the block, or NULL if allocation fails.
+ */
+static void *pool_alloc(void *ctx, size_t size)
+{
+    ListPool *pool = ctx;
+    if (size > POOL_MAX_BLOCK) {
+        void *block = backing_alloc(&pool->backing, size);
+        if (block != NULL) {
+            pool->large++;
+        }
+        return block;
+    }
+
+    size_t class = (size + POOL_GRANULE - 1) / POOL_GRANULE;
+    void *block = pool->free_blocks[class];
+    if (block != NULL) {
+        // A released block starts with a pointer to the next one
+        pool->free_blocks[class] = *(void **)block;
+        return block;
+    }
+
+    size_t block_size = class * POOL_GRANULE;
+    if ((size_t)(pool->bump_end - pool->bump) < block_size) {
+        struct list_pool_slab *slab = backing_alloc(&pool->backing, POOL_SLAB_SIZE);
+        if (slab == NULL) {
+            return NULL;
+        }
+        slab->next = pool->slabs;
+        slab->size = POOL_SLAB_SIZE;
+        pool->slabs = slab;
+        pool->bump = (char *)(slab + 1);
+        pool->bump_end = (char *)slab + POOL_SLAB_SIZE;
+    }
+    block = pool->bump;
+    pool->bump += block_size;
+    return block;
+}
+
+
+/**
+ * @brief Returns a block to a pool, onto the free list of its size class.
  *
- * Allocates memory for a new string and copies the content from the input string.
+ * @param[in] ctx The pool.
+ * @param[in] ptr The block.
+ * @param[in] size The size the block was allocated with.
+ */
+static void pool_free(void *ctx, void *ptr, size_t size)
+{
+    ListPool *pool = ctx;
+    if (size > POOL_MAX_BLOCK) {
+        pool->large--;
+        backing_free(&pool->backing, ptr, size);
+        return;
+    }
+    size_t class = (size + POOL_GRANULE - 1) / POOL_GRANULE;
+    *(void **)ptr = pool->free_blocks[class];
+    pool->free_blocks[class] = ptr;
+}
+
+
+/**
+ * @brief Returns the size of the block of a node with a value of the given length.
+ */
+static size_t node_size(size_t length)
+{
+    return sizeof(struct node) + length + 1;
+}
+
+
+/**
+ * @brief Returns the size of the block of a node.
  *
- * @param[in] in The input string to clone.
- * @return A pointer to the cloned string.
+ * A node with an owned value holds only the pointer to the string.
  */
-static char *clone_string(const char *in)
+static size_t node_block_size(const struct node *node)
 {
-    size_t len = strlen(in);
-    char *out = calloc(len + 1, sizeof(char));
+    if (node->length & OWNED_FLAG) {
+        return sizeof(struct node) + sizeof(char *);
+    }
+    return node_size(node->length);
+}
+
 
-    strncpy(out, in, len);
-    
-    return out;
+/**
+ * @brief Returns the string of a node that is not the sentinel.
+ */
+static const char *node_value(const struct node *node)
+{
+    if (node->length & OWNED_FLAG) {
+        const char *value;
+        memcpy(&value, node->value, sizeof(value));
+        return value;
+    }
+    return node->value;
 }
 
 
 /**
  * @brief Creates a new node for the list.
  *
- * Allocates memory for a new node and sets its value to the cloned input string.
+ * Allocates the node and a copy of the input string in one block, with the
+ * allocator of the list.
  *
+ * @param[in] lst The list the node is made for.
  * @param[in] value The value to assign to the node.
- * @return A pointer to the created node.
+ * @return A pointer to the created node, or NULL if allocation fails.
  */
-static struct node *make_node(const char *value)
+static struct node *make_node(List *lst, const char *value)
 {
-    struct node *new_node = (struct node *)malloc(sizeof(struct node));
-    new_node->value = clone_string(value);
+    size_t len = strlen(value);
+    struct node *new_node = backing_alloc(&lst->allocator, node_size(len));
+    if (new_node != NULL) {
+        new_node->length = len;
+        memcpy(new_node->value, value, len + 1);
+    }
     return new_node;
 }
 
 
+/**
+ * @brief Frees a node, and its value if owned, with the allocator of its list.
+ */
+static void free_node(List *lst, struct node *node)
+{
+    if (node->length & OWNED_FLAG) {
+        free((char *)node_value(node));
+    }
+    backing_free(&lst->allocator, node, node_block_size(node));
+}
+
+
+/**
+ * @brief Allocates a block of an unrolled list and links it in after another.
+ *
+ * An ordinary block is taken from the released blocks of the list, or
+ * carved from a new chunk. A larger block for a long value is allocated on
+ * its own.
+ *
+ * @param[in] lst The list the block is made for.
+ * @param[in] capacity The size of the data of the block.
+ * @param[in] after The block to link the new block in after.
+ * @return A pointer to the new block, or NULL if allocation fails.
+ */
+static struct list_block *make_block(List *lst, int capacity, struct list_block *after)
+{
+    struct list_block *block;
+    if (capacity > BLOCK_DATA) {
+        size_t size = (sizeof(struct list_block) + capacity + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+        block = aligned_alloc(BLOCK_SIZE, size);
+        if (block == NULL) {
+            return NULL;
+        }
+        capacity = (int)(size - sizeof(struct list_block));
+    } else {
+        if (lst->free_blocks == NULL) {
+            struct list_chunk *chunk = malloc(sizeof(struct list_chunk));
+            char *blocks = aligned_alloc(BLOCK_SIZE, CHUNK_BLOCKS * BLOCK_SIZE);
+            if (chunk == NULL || blocks == NULL) {
+                free(chunk);
+                free(blocks);
+                return NULL;
+            }
+            chunk->next = lst->chunks;
+            chunk->blocks = blocks;
+            lst->chunks = chunk;
+            // Released blocks are linked through their next pointers
+            for (int i = CHUNK_BLOCKS - 1; i >= 0; i--) {
+                struct list_block *spare = (struct list_block *)(blocks + (size_t)i * BLOCK_SIZE);
+                spare->next = lst->free_blocks;
+                lst->free_blocks = spare;
+            }
+        }
+        block = lst->free_blocks;
+        lst->free_blocks = block->next;
+        capacity = BLOCK_DATA;
+    }
+
+    block->count = 0;
+    block->used = 0;
+    block->garbage = 0;
+    block->capacity = capacity;
+    block->prev = after;
+    block->next = after->next;
+    after->next->prev = block;
+    after->next = block;
+    return block;
+}
+
+
+/**
+ * @brief Unlinks a block of an unrolled list and releases it.
+ *
+ * Ordinary blocks are kept for reuse until the list is destroyed.
+ */
+static void free_block(List *lst, struct list_block *block)
+{
+    block->prev->next = block->next;
+    block->next->prev = block->prev;
+    if (block->capacity > BLOCK_DATA) {
+        free(block);
+    } else {
+        block->next = lst->free_blocks;
+        lst->free_blocks = block;
+    }
+}
+
+
+/**
+ * @brief Returns the block of a position in an unrolled list.
+ */
+static struct list_block *block_of(ListPos pos)
+{
+    if (pos.slot == pos.list->blocks->slots) {
+        return pos.list->blocks;
+    }
+    return (struct list_block *)((uintptr_t)pos.slot & ~(uintptr_t)(BLOCK_SIZE - 1));
+}
+
+
+/**
+ * @brief Checks if a block has a free slot and room for a string of the given length.
+ */
+static bool block_fits(const struct list_block *block, size_t length)
+{
+    return block->count < BLOCK_SLOTS && length < (size_t)(block->capacity - block->used);
+}
+
+
+/**
+ * @brief Moves the strings of a block to the start of its data, dropping the garbage.
+ */
+static void block_compact(struct list_block *block)
+{
+    if (block->garbage == 0) {
+        return;
+    }
+    char buffer[BLOCK_DATA];
+    char *copy = block->capacity <= BLOCK_DATA ? buffer : malloc(block->capacity);
+    if (copy == NULL) {
+        return;
+    }
+    memcpy(copy, block->data, block->used);
+    int used = 0;
+    for (int i = 0; i < block->count; i++) {
+        struct list_slot *slot = &block->slots[i];
+        memcpy(block->data + used, copy + slot->offset, slot->length + 1);
+        slot->offset = used;
+        used += slot->length + 1;
+    }
+    block->used = used;
+    block->garbage = 0;
+    if (copy != buffer) {
+        free(copy);
+    }
+}
+
+
+/**
+ * @brief Moves the values from index first on of one block to the end of
+ * another, which must have room for them.
+ */
+static void block_move(struct list_block *from, int first, struct list_block *to)
+{
+    for (int i = first; i < from->count; i++) {
+        struct list_slot *slot = &from->slots[i];
+        memcpy(to->data + to->used, from->data + slot->offset, slot->length + 1);
+        to->slots[to->count].offset = to->used;
+        to->slots[to->count].length = slot->length;
+        to->count++;
+        to->used += slot->length + 1;
+        from->garbage += slot->length + 1;
+    }
+    from->count = first;
+}
+
+
+/**
+ * @brief Links a node in before a position of a linked list.
+ *
+ * @param[in] pos The position before which the node is linked in.
+ * @param[in] node The node to link in.
+ * @return The position of the node.
+ */
+static ListPos link_node(ListPos pos, struct node *node)
+{
+    // Find nodes before and after (may be the same node: the head of the list).
+    struct node *before = pos.node->prev;
+    struct node *after = pos.node;
+
+    // Link to node after.
+    node->next = after;
+    after->prev = node;
+
+    // Link to node before.
+    node->prev = before;
+    before->next = node;
+
+    // Return the position of the new element.
+    pos.node = node;
+    return pos;
+}
+
+
+/**
+ * @brief Inserts a value before a position of an unrolled list.
+ *
+ * A full block is compacted or split in half to make room. A value that
+ * still does not fit, or is appended to a full block, starts a new block.
+ *
+ * @param[in,out] pos The position before which the value is inserted, set
+ * to the position of the new value.
+ * @param[in] value The value to insert.
+ * @return true if the value was inserted, false if allocation fails.
+ */
+static bool block_insert(ListPos *pos, const char *value)
+{
+    List *lst = pos->list;
+    struct list_block *block = block_of(*pos);
+    int index = (int)(pos->slot - block->slots);
+    size_t length = strlen(value);
+
+    // At the end, append to the last block
+    if (block == lst->blocks) {
+        block = block->prev;
+        index = block->count;
+    }
+
+    if (block != lst->blocks && !block_fits(block, length)) {
+        block_compact(block);
+    }
+    if (block != lst->blocks && !block_fits(block, length) && index < block->count && block->count > 1) {
+        struct list_block *half = make_block(lst, block->capacity, block);
+        if (half == NULL) {
+            return false;
+        }
+        int mid = block->count / 2;
+        block_move(block, mid, half);
+        block_compact(block);
+        if (index > mid) {
+            block = half;
+            index -= mid;
+        }
+    }
+    if (block == lst->blocks || !block_fits(block, length)) {
+        // Start a new block with the value, before the block or after the
+        // values before the index, which are split off from the rest
+        struct list_block *after = block;
+        if (block != lst->blocks && index == 0) {
+            after = block->prev;
+        } else if (block != lst->blocks && index < block->count) {
+            struct list_block *rest = make_block(lst, block->capacity, block);
+            if (rest == NULL) {
+                return false;
+            }
+            block_move(block, index, rest);
+        }
+        int capacity = length < BLOCK_DATA ? BLOCK_DATA : (int)length + 1;
+        struct list_block *own = make_block(lst, capacity, after);
+        if (own == NULL) {
+            return false;
+        }
+        block = own;
+        index = 0;
+    }
+
+    memmove(&block->slots[index + 1], &block->slots[index], (block->count - index) * sizeof(struct list_slot));
+    block->slots[index].offset = block->used;
+    block->slots[index].length = (int)length;
+    memcpy(block->data + block->used, value, length + 1);
+    block->used += (int)length + 1;
+    block->count++;
+
+    pos->slot = &block->slots[index];
+    return true;
+}
+
+
+/**
+ * @brief Removes the value at a position of an unrolled list.
+ *
+ * An emptied block is freed, and a block that falls below a quarter full is
+ * merged with the next one when they fit together.
+ *
+ * @param[in] pos The position of the value to remove.
+ * @return The position of the next value.
+ */
+static ListPos block_remove(ListPos pos)
+{
+    List *lst = pos.list;
+    struct list_block *block = block_of(pos);
+    if (block == lst->blocks) {
+        return pos;
+    }
+    int index = (int)(pos.slot - block->slots);
+
+    block->garbage += block->slots[index].length + 1;
+    block->count--;
+    memmove(&block->slots[index], &block->slots[index + 1], (block->count - index) * sizeof(struct list_slot));
+
+    struct list_block *next = block->next;
+    if (block->count == 0) {
+        free_block(lst, block);
+        pos.slot = next->slots;
+        return pos;
+    }
+
+    if (block->count < BLOCK_SLOTS / 4 && next != lst->blocks && block->count + next->count <= BLOCK_SLOTS
+        && block->used - block->garbage + next->used - next->garbage <= block->capacity) {
+        block_compact(block);
+        block_move(next, 0, block);
+        free_block(lst, next);
+    }
+
+    if (index == block->count) {
+        pos.slot = block->next->slots;
+    }
+    return pos;
+}
+
+
+/**
+ * @brief Inserts a copy of a value before a position of any list.
+ *
+ * @param[in,out] pos The position before which the value is inserted, set
+ * to the position of the new value.
+ * @param[in] value The value to insert.
+ * @return true if the value was inserted, false if allocation fails.
+ */
+static bool insert_value(ListPos *pos, const char *value)
+{
+    if (pos->list->blocks != NULL) {
+        return block_insert(pos, value);
+    }
+    struct node *node = make_node(pos->list, value);
+    if (node == NULL) {
+        return false;
+    }
+    *pos = link_node(*pos, node);
+    return true;
+}
+
+
+/**
+ * @brief Checks if the nodes of two lists can be relinked from one to the other.
+ */
+static bool same_nodes(const List *a, const List *b)
+{
+    return a->blocks == NULL && b->blocks == NULL && a->allocator.alloc == b->allocator.alloc
+        && a->allocator.free == b->allocator.free && a->allocator.ctx == b->allocator.ctx;
+}
+
+
+/**
+ * @brief Moves a range of elements between lists by copying the values.
+ *
+ * The values are counted first, since removing values from an unrolled
+ * list invalidates the position of the end of the range.
+ *
+ * @param[in,out] dst_pos The position before which the elements are
+ *                inserted, set to the first moved element if any was.
+ * @param[in] src_first The position of the first element to move.
+ * @param[in] src_last The position after the last element to move.
+ * @return true if any element was moved.
+ */
+static bool splice_copy(ListPos *dst_pos, ListPos src_first, ListPos src_last)
+{
+    size_t count = 0;
+    for (ListPos pos = src_first; !list_pos_equal(pos, src_last); pos = list_next(pos)) {
+        count++;
+    }
+
+    size_t moved = 0;
+    ListPos pos = src_first;
+    ListPos next = *dst_pos;
+    while (moved < count) {
+        if (!insert_value(&next, list_inspect(pos))) {
+            break;
+        }
+        // Only the position of the new value stays valid in an unrolled list
+        next = list_next(next);
+        pos = list_remove(pos);
+        moved++;
+    }
+    if (moved == 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < moved; i++) {
+        next = list_prev(next);
+    }
+    *dst_pos = next;
+    return true;
+}
+
+
+/**
+ * @brief Merges two sorted NULL-terminated chains of nodes linked by next.
+ *
+ * On ties the node of a comes first, so a must hold the earlier nodes.
+ */
+static struct node *merge_runs(struct node *a, struct node *b, int (*cmp)(const char *, const char *))
+{
+    struct node *head = NULL;
+    struct node **tail = &head;
+    while (a != NULL && b != NULL) {
+        if (cmp(node_value(b), node_value(a)) < 0) {
+            *tail = b;
+            b = b->next;
+        } else {
+            *tail = a;
+            a = a->next;
+        }
+        tail = &(*tail)->next;
+    }
+    *tail = a != NULL ? a : b;
+    return head;
+}
+
+
+/**
+ * @brief Counts the values of a list.
+ */
+static size_t list_length(List *lst)
+{
+    size_t n = 0;
+    if (lst->blocks != NULL) {
+        for (struct list_block *block = lst->blocks->next; block != lst->blocks; block = block->next) {
+            n += block->count;
+        }
+    } else {
+        for (struct node *node = lst->head->next; node != lst->head; node = node->next) {
+            n++;
+        }
+    }
+    return n;
+}
+
+
+/**
+ * @brief Copies the values of a list, and the nodes of a linked list, into
+ * an array of n items followed by room for n more.
+ *
+ * @return The array, or NULL if allocation fails.
+ */
+static struct sort_item *extract_items(List *lst, size_t n)
+{
+    struct sort_item *items = malloc(2 * n * sizeof(struct sort_item));
+    if (items == NULL) {
+        return NULL;
+    }
+    size_t i = 0;
+    if (lst->blocks != NULL) {
+        for (struct list_block *block = lst->blocks->next; block != lst->blocks; block = block->next) {
+            for (int k = 0; k < block->count; k++) {
+                items[i].value = block->data + block->slots[k].offset;
+                items[i].node = NULL;
+                i++;
+            }
+        }
+    } else {
+        for (struct node *node = lst->head->next; node != lst->head; node = node->next) {
+            items[i].value = node_value(node);
+            items[i].node = node;
+            i++;
+        }
+    }
+    return items;
+}
+
+
+/**
+ * @brief Puts the values of a list in the order of an array of its items.
+ *
+ * A linked list is relinked. An unrolled list is rebuilt with new blocks,
+ * which replace the old ones only if all values could be inserted.
+ *
+ * @return true on success, false if allocation fails.
+ */
+static bool apply_items(List *lst, const struct sort_item *items, size_t n)
+{
+    if (lst->blocks == NULL) {
+        struct node *prev = lst->head;
+        for (size_t i = 0; i < n; i++) {
+            prev->next = items[i].node;
+            items[i].node->prev = prev;
+            prev = items[i].node;
+        }
+        prev->next = lst->head;
+        lst->head->prev = prev;
+        return true;
+    }
+
+    List *sorted = list_create_unrolled();
+    if (sorted == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        ListPos end = list_end(sorted);
+        if (!insert_value(&end, items[i].value)) {
+            list_destroy(sorted);
+            return false;
+        }
+    }
+    List old = *lst;
+    *lst = *sorted;
+    *sorted = old;
+    list_destroy(sorted);
+    return true;
+}
+
+
+/**
+ * @brief Sorts an array of items with a stable bottom-up merge sort.
+ *
+ * @param[in,out] items The items to sort.
+ * @param[in] temp Room for n items.
+ * @param[in] n The number of items.
+ * @param[in] cmp Compares two values like strcmp.
+ */
+static void merge_sort_items(struct sort_item *items, struct sort_item *temp, size_t n,
+                             int (*cmp)(const char *, const char *))
+{
+    struct sort_item *from = items;
+    struct sort_item *to = temp;
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = mid + width < n ? mid + width : n;
+            size_t i = lo;
+            size_t j = mid;
+            size_t k = lo;
+            while (i < mid && j < hi) {
+                to[k++] = cmp(from[j].value, from[i].value) < 0 ? from[j++] : from[i++];
+            }
+            while (i < mid) {
+                to[k++] = from[i++];
+            }
+            while (j < hi) {
+                to[k++] = from[j++];
+            }
+        }
+        struct sort_item *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != items) {
+        memcpy(items, from, n * sizeof(struct sort_item));
+    }
+}
+
+
+/**
+ * @brief Sorts a few items that share their first depth bytes by insertion.
+ */
+static void insertion_sort_items(struct sort_item *items, size_t n, size_t depth)
+{
+    for (size_t i = 1; i < n; i++) {
+        struct sort_item item = items[i];
+        const unsigned char *value = (const unsigned char *)item.value + depth;
+        size_t j = i;
+        while (j > 0) {
+            const unsigned char *a = (const unsigned char *)items[j - 1].value + depth;
+            const unsigned char *b = value;
+            while (*a != '\0' && *a == *b) {
+                a++;
+                b++;
+            }
+            if (*a <= *b) {
+                break;
+            }
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = item;
+    }
+}
+
+
+/**
+ * @brief Sorts items that share their first depth bytes by the byte at
+ * depth, then each bucket by the following bytes.
+ *
+ * The bytes are first read into the oracle in one pass, prefetching the
+ * strings ahead, so that counting and distributing the items touches no
+ * strings at all. The distribution is stable, and values that end at
+ * depth are equal and need no further sorting. A byte that all the items
+ * share is skipped without recursion.
+ *
+ * @param[in,out] items The items to sort.
+ * @param[in] temp Room for n items.
+ * @param[in] oracle Room for n bytes.
+ * @param[in] n The number of items.
+ * @param[in] depth The number of bytes the values share.
+ * @param[in] level The number of enclosing buckets.
+ */
+static void radix_sort_items(struct sort_item *items, struct sort_item *temp, unsigned char *oracle,
+                             size_t n, size_t depth, int level)
+{
+    if (n < RADIX_CUTOFF) {
+        insertion_sort_items(items, n, depth);
+        return;
+    }
+    if (level >= RADIX_MAX_LEVELS) {
+        merge_sort_items(items, temp, n, strcmp);
+        return;
+    }
+
+    size_t count[256];
+    for (;;) {
+        memset(count, 0, sizeof(count));
+        for (size_t i = 0; i < n; i++) {
+#if defined(__GNUC__) || defined(__clang__)
+            if (i + RADIX_PREFETCH < n) {
+                __builtin_prefetch(items[i + RADIX_PREFETCH].value + depth);
+            }
+#endif
+            oracle[i] = (unsigned char)items[i].value[depth];
+            count[oracle[i]]++;
+        }
+        if (count[0] == n) {
+            return;
+        }
+        if (count[oracle[0]] < n) {
+            break;
+        }
+        depth++;
+    }
+
+    size_t start[256];
+    size_t sum = 0;
+    for (int c = 0; c < 256; c++) {
+        start[c] = sum;
+        sum += count[c];
+    }
+    for (size_t i = 0; i < n; i++) {
+        temp[start[oracle[i]]++] = items[i];
+    }
+    memcpy(items, temp, n * sizeof(struct sort_item));
+
+    // Bucket 0 holds the values that end here
+    size_t first = count[0];
+    for (int c = 1; c < 256; c++) {
+        if (count[c] > 1) {
+            radix_sort_items(items + first, temp, oracle, count[c], depth + 1, level + 1);
+        }
+        first += count[c];
+    }
+}
+
+
 /* ---------------------- External functions ---------------------- */
 
 List *list_create(void) {
-    List *lst = malloc(sizeof(List));
+    return list_create_with_allocator(NULL);
+}
+
+
+List *list_create_with_allocator(const ListAllocator *allocator) {
+    // The sentinel node is allocated in the same block, right after the list
+    List *lst = malloc(sizeof(List) + sizeof(struct node));
     if (lst != NULL) {
-        lst->head.next = &lst->head;
-        lst->head.prev = &lst->head;
-        lst->head.value = NULL;
+        lst->head = (struct node *)(lst + 1);
+        lst->head->next = lst->head;
+        lst->head->prev = lst->head;
+        lst->head->length = HEAD_LENGTH;
+        lst->blocks = NULL;
+        if (allocator != NULL) {
+            lst->allocator = *allocator;
+        } else {
+            lst->allocator = (ListAllocator){NULL, NULL, NULL};
+        }
+        lst->own_pool = NULL;
+        lst->chunks = NULL;
+        lst->free_blocks = NULL;
+        lst->owned = false;
+    }
+    return lst;
+}
+
+
+List *list_create_pooled(void) {
+    ListPool *pool = list_pool_create(NULL);
+    if (pool == NULL) {
+        return NULL;
+    }
+    ListAllocator allocator = list_pool_allocator(pool);
+    List *lst = list_create_with_allocator(&allocator);
+    if (lst == NULL) {
+        list_pool_destroy(pool);
+        return NULL;
+    }
+    lst->own_pool = pool;
+    return lst;
+}
+
+
+List *list_create_unrolled(void) {
+    List *lst = malloc(sizeof(List));
+    struct list_block *sentinel = malloc(sizeof(struct list_block));
+    if (lst == NULL || sentinel == NULL) {
+        free(lst);
+        free(sentinel);
+        return NULL;
     }
+
+    lst->head = NULL;
+    lst->blocks = sentinel;
+    lst->blocks->next = lst->blocks;
+    lst->blocks->prev = lst->blocks;
+    lst->blocks->count = 0;
+    lst->blocks->used = 0;
+    lst->blocks->garbage = 0;
+    lst->blocks->capacity = 0;
+    lst->allocator = (ListAllocator){NULL, NULL, NULL};
+    lst->own_pool = NULL;
+    lst->chunks = NULL;
+    lst->free_blocks = NULL;
+    lst->owned = false;
     return lst;
 }
 
 
+ListPool *list_pool_create(const ListAllocator *backing) {
+    ListPool *pool = calloc(1, sizeof(ListPool));
+    if (pool != NULL && backing != NULL) {
+        pool->backing = *backing;
+    }
+    return pool;
+}
+
+
+ListAllocator list_pool_allocator(ListPool *pool) {
+    ListAllocator allocator = {
+        .alloc = pool_alloc,
+        .free = pool_free,
+        .ctx = pool
+    };
+
+    return allocator;
+}
+
+
+void list_pool_destroy(ListPool *pool) {
+    if (pool != NULL) {
+        while (pool->slabs != NULL) {
+            struct list_pool_slab *next = pool->slabs->next;
+            backing_free(&pool->backing, pool->slabs, pool->slabs->size);
+            pool->slabs = next;
+        }
+        free(pool);
+    }
+}
+
+
 void list_destroy(List *lst) {
-    if (lst != NULL) {
-        struct node *current = lst->head.next;
-        while (current != &lst->head) {
-            struct node *next = current->next;
-            free(current->value);
-            free(current);
-            current = next;
+    if (lst != NULL && lst->blocks != NULL) {
+        while (lst->blocks->next != lst->blocks) {
+            free_block(lst, lst->blocks->next);
+        }
+        while (lst->chunks != NULL) {
+            struct list_chunk *next = lst->chunks->next;
+            free(lst->chunks->blocks);
+            free(lst->chunks);
+            lst->chunks = next;
         }
+        free(lst->blocks);
+        free(lst);
+    } else if (lst != NULL) {
+        // The slabs of an own pool go at once; only large nodes and owned
+        // values are freed one by one
+        if (lst->own_pool == NULL || lst->own_pool->large > 0 || lst->owned) {
+            struct node *current = lst->head->next;
+            while (current != lst->head) {
+                struct node *next = current->next;
+                if (lst->own_pool == NULL || node_block_size(current) > POOL_MAX_BLOCK) {
+                    free_node(lst, current);
+                } else if (current->length & OWNED_FLAG) {
+                    free((char *)node_value(current));
+                }
+                current = next;
+            }
+        }
+        list_pool_destroy(lst->own_pool);
         free(lst);
     }
 }
 
 
 bool list_is_empty(const List *lst) {
-    return lst->head.next == &lst->head;
+    if (lst->blocks != NULL) {
+        return lst->blocks->next == lst->blocks;
+    }
+    return lst->head->next == lst->head;
 }
 
 
 ListPos list_first(List *lst) {
     ListPos pos = {
-        .node = lst->head.next
+        .node = lst->head != NULL ? lst->head->next : NULL,
+        .list = lst
     };
+    if (lst->blocks != NULL) {
+        pos.slot = lst->blocks->next->slots;
+    }
 
     return pos; 
 }
@@ -99,8 +1086,12 @@ ListPos list_first(List *lst) {
 
 ListPos list_end(List *lst) {
     ListPos pos = {
-        .node = &lst->head
+        .node = lst->head,
+        .list = lst
     };
+    if (lst->blocks != NULL) {
+        pos.slot = lst->blocks->slots;
+    }
 
     return pos;
 }
@@ -113,6 +1104,16 @@ bool list_pos_equal(ListPos p1, ListPos p2) {
 
 ListPos list_next(ListPos pos) {
     ListPos next_pos;
+    next_pos.list = pos.list;
+    if (pos.list->blocks != NULL) {
+        struct list_block *block = block_of(pos);
+        if (pos.slot + 1 < block->slots + block->count) {
+            next_pos.slot = pos.slot + 1;
+        } else {
+            next_pos.slot = block->next->slots;
+        }
+        return next_pos;
+    }
     next_pos.node = pos.node->next;
     return next_pos;
 }
@@ -120,45 +1121,247 @@ ListPos list_next(ListPos pos) {
 
 ListPos list_prev(ListPos pos) {
     ListPos prev_pos;
+    prev_pos.list = pos.list;
+    if (pos.list->blocks != NULL) {
+        struct list_block *block = block_of(pos);
+        if (pos.slot > block->slots) {
+            prev_pos.slot = pos.slot - 1;
+        } else {
+            block = block->prev;
+            prev_pos.slot = block->slots + (block->count > 0 ? block->count - 1 : 0);
+        }
+        return prev_pos;
+    }
     prev_pos.node = pos.node->prev;
     return prev_pos;
 }
 
 
 ListPos list_insert(ListPos pos, const char *value) {
-    // Create a new node.
-    struct node *node = make_node(value);
-
-    // Find nodes before and after (may be the same node: the head of the list).
-    struct node *before = pos.node->prev;
-    struct node *after = pos.node;
-
-    // Link to node after.
-    node->next = after;
-    after->prev = node;
-
-    // Link to node before.
-    node->prev = before;
-    before->next = node;
-
-    // Return the position of the new element.
-    pos.node = node;
+    insert_value(&pos, value);
     return pos;
 }
 
 
 ListPos list_remove(ListPos pos) {
-    if (pos.node->value != NULL) { 
+    if (pos.list->blocks != NULL) {
+        return block_remove(pos);
+    }
+    if (pos.node->length != HEAD_LENGTH) { 
         pos.node->prev->next = pos.node->next;
         pos.node->next->prev = pos.node->prev;
-        ListPos next_pos = {pos.node->next};
-        free(pos.node->value);
-        free(pos.node);
+        ListPos next_pos = {.node = pos.node->next, .list = pos.list};
+        free_node(pos.list, pos.node);
         return next_pos;
     }
     return pos;
 }
 
+bool list_insert_owned(ListPos *pos, char *value) {
+    if (pos->list->blocks != NULL) {
+        if (!block_insert(pos, value)) {
+            return false;
+        }
+        free(value);
+        return true;
+    }
+
+    // The node holds just the pointer to the string
+    struct node *node = backing_alloc(&pos->list->allocator, sizeof(struct node) + sizeof(char *));
+    if (node == NULL) {
+        return false;
+    }
+    node->length = strlen(value) | OWNED_FLAG;
+    memcpy(node->value, &value, sizeof(value));
+    pos->list->owned = true;
+    *pos = link_node(*pos, node);
+    return true;
+}
+
+
+char *list_take(ListPos pos, ListPos *next) {
+    if (next != NULL) {
+        *next = pos;
+    }
+    const char *value = list_inspect(pos);
+    if (value == NULL) {
+        return NULL;
+    }
+
+    // Values in blocks or in nodes of another allocator are copied out
+    if (pos.list->blocks != NULL || (!(pos.node->length & OWNED_FLAG) && pos.list->allocator.alloc != NULL)) {
+        size_t len = list_inspect_length(pos);
+        char *copy = malloc(len + 1);
+        if (copy == NULL) {
+            return NULL;
+        }
+        memcpy(copy, value, len + 1);
+        pos = list_remove(pos);
+        if (next != NULL) {
+            *next = pos;
+        }
+        return copy;
+    }
+
+    struct node *node = pos.node;
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    if (next != NULL) {
+        next->node = node->next;
+    }
+
+    if (node->length & OWNED_FLAG) {
+        // Hand over the string and release the node
+        backing_free(&pos.list->allocator, node, node_block_size(node));
+        return (char *)value;
+    }
+    // Hand over the node itself, with the string moved to its start
+    memmove(node, node->value, node->length + 1);
+    return (char *)node;
+}
+
+
+bool list_splice(ListPos *dst_pos, ListPos src_first, ListPos src_last) {
+    if (list_pos_equal(src_first, src_last)) {
+        return false;
+    }
+    if (!same_nodes(dst_pos->list, src_first.list)) {
+        if (dst_pos->list == src_first.list) {
+            return false;
+        }
+        return splice_copy(dst_pos, src_first, src_last);
+    }
+
+    struct node *first = src_first.node;
+    struct node *last = src_last.node->prev;
+    struct node *dst = dst_pos->node;
+
+    // Unlink the range from the source.
+    first->prev->next = src_last.node;
+    src_last.node->prev = first->prev;
+
+    // Link it in before the destination.
+    first->prev = dst->prev;
+    last->next = dst;
+    dst->prev->next = first;
+    dst->prev = last;
+
+    dst_pos->list->owned = dst_pos->list->owned || src_first.list->owned;
+    dst_pos->node = first;
+    return true;
+}
+
+
+void list_concat(List *dst, List *src) {
+    ListPos end = list_end(dst);
+    list_splice(&end, list_first(src), list_end(src));
+}
+
+
+List *list_split_at(ListPos pos) {
+    List *lst = pos.list;
+    List *rest;
+    if (lst->blocks != NULL) {
+        rest = list_create_unrolled();
+    } else if (lst->own_pool != NULL) {
+        rest = list_create_pooled();
+    } else {
+        rest = list_create_with_allocator(&lst->allocator);
+    }
+    if (rest != NULL) {
+        ListPos end = list_end(rest);
+        list_splice(&end, pos, list_end(lst));
+    }
+    return rest;
+}
+
+
+bool list_sort(List *lst, int (*cmp)(const char *a, const char *b)) {
+    if (list_is_empty(lst)) {
+        return true;
+    }
+    if (lst->blocks != NULL) {
+        size_t n = list_length(lst);
+        struct sort_item *items = extract_items(lst, n);
+        if (items == NULL) {
+            return false;
+        }
+        merge_sort_items(items, items + n, n, cmp);
+        bool sorted = apply_items(lst, items, n);
+        free(items);
+        return sorted;
+    }
+
+    // runs[i] is a sorted chain of 2^i nodes, or NULL, with the earlier
+    // nodes in the higher runs, like the digits of a binary counter.
+    struct node *runs[64] = {NULL};
+    struct node *current = lst->head->next;
+    lst->head->prev->next = NULL;
+    while (current != NULL) {
+        struct node *next = current->next;
+        current->next = NULL;
+        struct node *run = current;
+        int i = 0;
+        while (runs[i] != NULL) {
+            run = merge_runs(runs[i], run, cmp);
+            runs[i] = NULL;
+            i++;
+        }
+        runs[i] = run;
+        current = next;
+    }
+
+    struct node *sorted = NULL;
+    for (int i = 0; i < 64; i++) {
+        if (runs[i] != NULL) {
+            sorted = merge_runs(runs[i], sorted, cmp);
+        }
+    }
+
+    // Restore the prev links and close the circle through the sentinel
+    struct node *prev = lst->head;
+    for (struct node *node = sorted; node != NULL; node = node->next) {
+        prev->next = node;
+        node->prev = prev;
+        prev = node;
+    }
+    prev->next = lst->head;
+    lst->head->prev = prev;
+    return true;
+}
+
+
+bool list_radix_sort(List *lst) {
+    if (list_is_empty(lst)) {
+        return true;
+    }
+    size_t n = list_length(lst);
+    struct sort_item *items = extract_items(lst, n);
+    unsigned char *oracle = malloc(n);
+    if (items == NULL || oracle == NULL) {
+        free(items);
+        free(oracle);
+        return list_sort(lst, strcmp);
+    }
+    radix_sort_items(items, items + n, oracle, n, 0, 0);
+    bool sorted = apply_items(lst, items, n);
+    free(items);
+    free(oracle);
+    return sorted;
+}
+
+
 const char *list_inspect(ListPos pos) {
-    return pos.node->value;
+    if (pos.list->blocks != NULL) {
+        struct list_block *block = block_of(pos);
+        return block != pos.list->blocks ? block->data + pos.slot->offset : NULL;
+    }
+    return pos.node->length != HEAD_LENGTH ? node_value(pos.node) : NULL;
+}
+
+size_t list_inspect_length(ListPos pos) {
+    if (pos.list->blocks != NULL) {
+        return block_of(pos) != pos.list->blocks ? (size_t)pos.slot->length : 0;
+    }
+    return pos.node->length != HEAD_LENGTH ? pos.node->length & ~OWNED_FLAG : 0;
 }
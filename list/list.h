@@ -2,6 +2,7 @@
 #define LIST_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @defgroup list_h Doubly Linked List
@@ -24,29 +25,95 @@
 
 /**
  *  @brief This structure represents a node in the list.
+ *
+ *  The value is stored inline after the links, so every element is a
+ *  single allocation. A value moved in with list_insert_owned stays in its
+ *  own buffer instead, and the node holds a pointer to it, with the top bit
+ *  of the length set.
  */
 struct node
 {
     struct node *next; /**< Pointer to the next node.**/
     struct node *prev; /**< Pointer to the previous node.**/
-    char *value;       /**< Pointer to the value stored in the node.**/
+    size_t length;     /**< Length of the value, without the terminator, and the owned flag.**/
+    char value[];      /**< The null-terminated value stored in the node, or
+                            a pointer to an owned value.**/
 };
 
+/**
+ *  @brief Value slot in a block of an unrolled list.
+ *
+ *  The layout is private to the implementation.
+ */
+struct list_slot;
+
+/**
+ *  @brief Block of values of an unrolled list.
+ *
+ *  The layout is private to the implementation.
+ */
+struct list_block;
+
+/**
+ *  @brief Chunk of memory that blocks of an unrolled list are carved from.
+ *
+ *  The layout is private to the implementation.
+ */
+struct list_chunk;
+
+/**
+ *  @brief Custom allocator for the nodes of a list.
+ *
+ *  Every node, including its value, is one block. free is given the size
+ *  that was passed to alloc for the block.
+ */
+typedef struct list_allocator
+{
+    void *(*alloc)(void *ctx, size_t size);           /**< Allocates a block, or returns NULL.**/
+    void (*free)(void *ctx, void *ptr, size_t size);  /**< Frees a block.**/
+    void *ctx;                                        /**< Passed to alloc and free.**/
+} ListAllocator;
+
+/**
+ *  @brief Pool that recycles node blocks in size classes.
+ *
+ *  Small blocks are carved from large slabs and kept on a free list per
+ *  size class when released, so a steady stream of inserts and removes
+ *  makes no calls to malloc at all. A pool is not thread-safe; it can be
+ *  shared by lists that are used from the same thread.
+ */
+typedef struct list_pool ListPool;
+
 /**
  *  @brief Defines the structure for a list.
  */
 typedef struct list
 {
-    struct node head;  /**< Sentinel node acting as the list head.**/    
+    struct node *head;               /**< Sentinel node acting as the list head, allocated with the list.**/
+    struct list_block *blocks;       /**< Sentinel block of an unrolled list, or NULL.**/
+    ListAllocator allocator;         /**< Allocator of the nodes, with alloc NULL for malloc.**/
+    ListPool *own_pool;              /**< Pool created for and destroyed with this list, or NULL.**/
+    struct list_chunk *chunks;       /**< Chunks of the blocks of an unrolled list.**/
+    struct list_block *free_blocks;  /**< Released blocks of an unrolled list.**/
+    bool owned;                      /**< Whether any node may hold an owned value.**/
 } List;
 
 
 /**
  *  @brief This structure represents a position within the list.
+ *
+ *  In an unrolled list, a position is the slot of a value in a block.
+ *  Inserting or removing a value may move the other values of its block
+ *  and the next one, so only the positions returned by list_insert and
+ *  list_remove stay valid after them.
  */
 typedef struct list_pos
 {
-    struct node *node; /**< Pointer to the current node at this position.**/
+    union {
+        struct node *node;       /**< Pointer to the current node at this position.**/
+        struct list_slot *slot;  /**< Pointer to the current slot of an unrolled list.**/
+    };
+    List *list;                  /**< The list the node belongs to.**/
 } ListPos;
 
 /**
@@ -59,11 +126,69 @@ typedef struct list_pos
  */
 List *list_create(void);
 
+/**
+ * @brief Creates an empty list whose nodes are allocated by a custom allocator.
+ *
+ * @param allocator The allocator, which is copied, or NULL for malloc.
+ * @return A pointer to the newly created list, or NULL on failure.
+ */
+List *list_create_with_allocator(const ListAllocator *allocator);
+
+/**
+ * @brief Creates an empty list with a pool of its own.
+ *
+ * list_destroy releases the pool's slabs at once, without visiting the nodes.
+ *
+ * @return A pointer to the newly created list, or NULL on failure.
+ */
+List *list_create_pooled(void);
+
+/**
+ * @brief Creates an empty unrolled list.
+ *
+ * An unrolled list stores many values, with their strings, in each block, so
+ * a scan touches a few contiguous blocks instead of one node per value, and
+ * needs far less memory for short values. All other list functions work on
+ * it as usual, but see ListPos about which positions stay valid. The blocks
+ * are carved from chunks allocated with aligned_alloc, and are kept for
+ * reuse until the list is destroyed.
+ *
+ * @return A pointer to the newly created list, or NULL on failure.
+ */
+List *list_create_unrolled(void);
+
+/**
+ * @brief Creates a pool of node blocks.
+ *
+ * @param backing The allocator for the slabs and for blocks too large for
+ * the size classes, which is copied, or NULL for malloc.
+ * @return A pointer to the new pool, or NULL on failure.
+ */
+ListPool *list_pool_create(const ListAllocator *backing);
+
+/**
+ * @brief Returns an allocator that takes node blocks from a pool.
+ *
+ * @param pool The pool, which must outlive the lists using it.
+ * @return The allocator, to be passed to list_create_with_allocator.
+ */
+ListAllocator list_pool_allocator(ListPool *pool);
+
+/**
+ * @brief Destroys a pool and releases all its slabs.
+ *
+ * The lists using the pool must be destroyed first.
+ *
+ * @param pool The pool to destroy.
+ */
+void list_pool_destroy(ListPool *pool);
+
 /**
  * @brief Deallocates a list and all of its elements.
  *
  * Traverses the list and deallocates each node and its value. Finally,
- * the list itself is deallocated.
+ * the list itself is deallocated. A list with a pool of its own instead
+ * releases the pool's slabs.
  *
  * @param lst A pointer to the list to destroy.
  * @return -
@@ -132,6 +257,22 @@ ListPos list_prev(ListPos pos);
  */
 ListPos list_insert(ListPos pos, const char *value);
 
+/**
+ * @brief Inserts a malloc'd string before the given position, taking
+ * ownership of it.
+ *
+ * In a linked list the string is not copied: the new node holds a pointer
+ * to it, and the string is freed with the node. An unrolled list copies the
+ * string into a block and frees it.
+ *
+ * @param pos The position before which the new value will be inserted, set
+ * to the position of the newly inserted element on success.
+ * @param value The value to insert, allocated with malloc.
+ * @return true on success, or false if allocation fails, in which case the
+ * caller keeps ownership of value.
+ */
+bool list_insert_owned(ListPos *pos, char *value);
+
 /**
  * @brief Removes an element at the given position.
  *
@@ -143,14 +284,115 @@ ListPos list_insert(ListPos pos, const char *value);
  */
 ListPos list_remove(ListPos pos);
 
+/**
+ * @brief Removes an element at the given position and returns its value.
+ *
+ * A value inserted with list_insert_owned is handed back as it is. In a
+ * list with malloc'd nodes, any other value is handed over in its node,
+ * with the string moved to the start. Only values in pooled, custom
+ * allocated or unrolled lists are copied into a new string.
+ *
+ * @param pos The position of the element to remove.
+ * @param next Set to the position of the next element, or NULL.
+ * @return The value, to be freed by the caller, or NULL at the end of the
+ * list or if allocation fails, in which case the element is kept.
+ */
+char *list_take(ListPos pos, ListPos *next);
+
+/**
+ * @brief Moves the elements from src_first up to, but not including,
+ * src_last before dst_pos.
+ *
+ * Between linked lists with the same allocator, or within one linked list,
+ * the nodes are relinked in constant time without allocation or copying.
+ * Otherwise, that is for unrolled lists or lists with different allocators
+ * (such as two lists with pools of their own), the values are copied one
+ * by one and removed from the source, stopping early if allocation fails.
+ * dst_pos must not lie in the range, and a range cannot be moved within
+ * one unrolled list.
+ *
+ * @param dst_pos The position before which the elements are inserted, set
+ * to the position of the first moved element if any was moved.
+ * @param src_first The position of the first element to move.
+ * @param src_last The position after the last element to move.
+ * @return true if any element was moved, or false if the range is empty or
+ * cannot be moved, or allocation fails before the first element.
+ */
+bool list_splice(ListPos *dst_pos, ListPos src_first, ListPos src_last);
+
+/**
+ * @brief Moves all elements of one list to the end of another.
+ *
+ * Takes constant time under the same conditions as list_splice.
+ *
+ * @param dst The list to append to.
+ * @param src The list to empty, which is not destroyed.
+ */
+void list_concat(List *dst, List *src);
+
+/**
+ * @brief Splits a list in two at the given position.
+ *
+ * The new list uses the allocator of the old one and takes its nodes in
+ * constant time. A list with a pool of its own, or an unrolled list,
+ * instead gets a new list of the same kind with copies of the values.
+ *
+ * @param pos The position of the first element to move to the new list.
+ * @return A new list with the elements from pos on, or NULL on failure.
+ */
+List *list_split_at(ListPos pos);
+
+/**
+ * @brief Sorts a list with a comparison function.
+ *
+ * A linked list is sorted in place with a bottom-up merge sort that
+ * relinks the nodes, without allocation. Every merge follows the links,
+ * so for lists much larger than the cache list_radix_sort is faster. An
+ * unrolled list is rebuilt from a sorted array of its values. The sort is
+ * stable, and all positions in the list are invalid afterwards.
+ *
+ * @param lst A pointer to the list.
+ * @param cmp Compares two values like strcmp.
+ * @return true on success, false if allocation fails for an unrolled list,
+ * which is then left unchanged.
+ */
+bool list_sort(List *lst, int (*cmp)(const char *a, const char *b));
+
+/**
+ * @brief Sorts a list in the order of strcmp with a string radix sort.
+ *
+ * Distributes the values by one byte at a time, most significant first,
+ * and sorts small buckets by insertion. Needs about 33 bytes of temporary
+ * memory per value, but no string comparisons above the small buckets.
+ * Falls back to list_sort with strcmp if the memory is not available. The
+ * sort is stable, and all positions in the list are invalid afterwards.
+ *
+ * @param lst A pointer to the list.
+ * @return true on success, false if allocation fails for an unrolled list,
+ * which is then left unchanged.
+ */
+bool list_radix_sort(List *lst);
+
 /**
  * @brief Retrieves the value at the given list position.
  *
  * @param pos The position of the element.
- * @return The value of the element at the given position.
+ * @return The value of the element at the given position, or NULL at the
+ * end of the list.
  */
 const char *list_inspect(ListPos pos);
 
+/**
+ * @brief Retrieves the length of the value at the given list position.
+ *
+ * The length is stored in the node, so this takes constant time.
+ *
+ * @param pos The position of the element.
+ * @return The length of the value without the terminator, or 0 at the end
+ * of the list.
+ */
+size_t list_inspect_length(ListPos pos);
+
 #endif /* LIST_H */
 /**
  * @}
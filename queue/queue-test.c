@@ -0,0 +1,107 @@
+/*
+ * File:         queue-test.c
+ * Description:  A program to test the queue module.
+ *
+ *               Build with the list module, for example:
+ *               gcc -I../list queue-test.c queue.c ../list/list.c
+ *
+ * Author:       Emil Engvall
+ */
+
+#include "queue.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+
+void print_test_result(bool condition, const char *test_name);
+char *clone(const char *value);
+bool round_trip(Queue *q);
+void test_round_trip(void);
+void test_peek(void);
+
+
+int main(void)
+{
+    test_round_trip();
+    test_peek();
+    return 0;
+}
+
+// Print the result of a test.
+void print_test_result(bool condition, const char *test_name)
+{
+    printf("%s: %s\n", condition ? "PASS" : "FAIL", test_name);
+}
+
+// Returns a malloc'd copy of a string.
+char *clone(const char *value)
+{
+    char *copy = malloc(strlen(value) + 1);
+    strcpy(copy, value);
+    return copy;
+}
+
+// Enqueues owned and copied values in turn, dequeues them in both ways and
+// checks that they come out in order, then leaves some for queue_destroy.
+bool round_trip(Queue *q)
+{
+    bool condition = queue_is_empty(q);
+    char expected[32];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(expected, sizeof(expected), "value-%d", i);
+        if (i % 2 == 0) {
+            condition = condition && queue_enqueue_owned(q, clone(expected));
+        } else {
+            queue_enqueue(q, expected);
+        }
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(expected, sizeof(expected), "value-%d", i);
+        char *value = i % 3 == 0 ? queue_dequeue(q) : queue_dequeue_owned(q);
+        condition = condition && value != NULL && strcmp(value, expected) == 0;
+        free(value);
+    }
+    condition = condition && queue_is_empty(q);
+
+    queue_enqueue_owned(q, clone("owned"));
+    queue_enqueue(q, "copied");
+    return condition && !queue_is_empty(q);
+}
+
+// Pass values through a queue and a pooled queue.
+void test_round_trip(void)
+{
+    Queue *q = queue_create();
+    bool condition = round_trip(q);
+    queue_destroy(q);
+    print_test_result(condition, "queue_enqueue_owned and queue_dequeue_owned");
+
+    q = queue_create_pooled();
+    condition = q != NULL && round_trip(q);
+    queue_destroy(q);
+    print_test_result(condition, "queue_create_pooled");
+}
+
+// Peek at the head of a queue, which stays in the queue.
+void test_peek(void)
+{
+    Queue *q = queue_create_pooled();
+    bool condition = queue_peek(q) == NULL;
+
+    queue_enqueue_owned(q, clone("first"));
+    queue_enqueue(q, "second");
+    condition = condition && strcmp(queue_peek(q), "first") == 0
+        && strcmp(queue_peek(q), "first") == 0;
+
+    char *value = queue_dequeue(q);
+    condition = condition && strcmp(value, "first") == 0 && strcmp(queue_peek(q), "second") == 0;
+    free(value);
+
+    value = queue_dequeue_owned(q);
+    condition = condition && strcmp(value, "second") == 0 && queue_peek(q) == NULL && queue_is_empty(q);
+    free(value);
+    queue_destroy(q);
+    print_test_result(condition, "queue_peek");
+}
@@ -14,52 +14,36 @@
 #include "queue.h"
 #include "list.h"
 #include <stdlib.h>
-#include <string.h>
 #include <stdio.h>
 
-/* ---------------------- Internal functions ---------------------- */
-
-/**
- * @brief Clones a string.
- *
- * Allocates memory for a new string and copies the content from the input string.
- *
- * @param[in] in The input string to clone.
- * @return A pointer to the cloned string.
- */
+/* ---------------------- External functions ---------------------- */
 
-static char *clone_string(const char *in) 
+Queue *queue_create(void) 
 {
-    if (in == NULL) {
-        perror("Error in clone_string: Input string is NULL");
+    Queue *q = malloc(sizeof(Queue));
+    if (!q) {
+        perror("Error in queue_create: Memory allocation failed");
         return NULL;
     }
-
-    size_t len = strlen(in);
-    char *out = calloc(len + 1, sizeof(char));
-
-    if (out == NULL) {
-        perror("Error in clone_string: Memory allocation failed for output string");
+    q->list = list_create();
+    if (!q->list) {
+        perror("Error in queue_create: List creation failed");
+        free(q);
         return NULL;
     }
-
-    strncpy(out, in, len);
-    
-    return out;
+    return q;
 }
 
-/* ---------------------- External functions ---------------------- */
-
-Queue *queue_create(void) 
+Queue *queue_create_pooled(void) 
 {
     Queue *q = malloc(sizeof(Queue));
     if (!q) {
-        perror("Error in queue_create: Memory allocation failed");
+        perror("Error in queue_create_pooled: Memory allocation failed");
         return NULL;
     }
-    q->list = list_create();
+    q->list = list_create_pooled();
     if (!q->list) {
-        perror("Error in queue_create: List creation failed");
+        perror("Error in queue_create_pooled: List creation failed");
         free(q);
         return NULL;
     }
@@ -85,26 +69,55 @@ void queue_enqueue(Queue *q, const char *value)
     list_insert(list_end(q->list), value);
 }
 
+bool queue_enqueue_owned(Queue *q, char *value) 
+{
+    if (!q || !value) {
+        perror("Error in queue_enqueue_owned: Null pointer received");
+        return false;
+    }
+    ListPos end = list_end(q->list);
+    if (!list_insert_owned(&end, value)) {
+        perror("Error in queue_enqueue_owned: Memory allocation failed");
+        return false;
+    }
+    return true;
+}
+
 char *queue_dequeue(Queue *q) 
+{
+    return queue_dequeue_owned(q);
+}
+
+char *queue_dequeue_owned(Queue *q) 
 {
     if (!q) {
-        perror("Error in queue_dequeue: Null pointer received");
+        perror("Error in queue_dequeue_owned: Null pointer received");
         return NULL;
     }
     if (list_is_empty(q->list)) {
-        perror("Error in queue_dequeue: Queue is empty");
+        perror("Error in queue_dequeue_owned: Queue is empty");
         return NULL;
     }
-    ListPos pos = list_first(q->list);
-    char *value = clone_string(list_inspect(pos));
+    char *value = list_take(list_first(q->list), NULL);
     if (!value) {
-        perror("Error in queue_dequeue: clone_string failed");
+        perror("Error in queue_dequeue_owned: Memory allocation failed");
         return NULL;
     }
-    list_remove(pos);
     return value;
 }
 
+const char *queue_peek(const Queue *q) 
+{
+    if (!q) {
+        perror("Error in queue_peek: Null pointer received");
+        return NULL;
+    }
+    if (list_is_empty(q->list)) {
+        return NULL;
+    }
+    return list_inspect(list_first(q->list));
+}
+
 bool queue_is_empty(const Queue *q) 
 {
     if (!q) {
@@ -40,6 +40,17 @@ typedef struct queue
  */
 Queue *queue_create(void);
 
+/**
+ * @brief Creates and returns an empty queue whose nodes come from a pool.
+ *
+ * The queue's list has a pool of its own (see list_create_pooled), so
+ * enqueueing and dequeueing reuse node blocks instead of calling malloc and
+ * free, and queue_destroy releases the blocks at once.
+ *
+ * @return A pointer to the newly created queue, or NULL on failure.
+ */
+Queue *queue_create_pooled(void);
+
 /**
  * @brief Deallocates a queue and all of its elements.
  *
@@ -62,17 +73,56 @@ void queue_destroy(Queue *q);
  */
 void queue_enqueue(Queue *q, const char *value);
 
+/**
+ * @brief Adds a malloc'd value to the tail of the queue, taking ownership of it.
+ *
+ * A small node holding the pointer to the buffer is allocated, and the
+ * string is not copied (see list_insert_owned). queue_destroy frees the
+ * buffer if the value is still in the queue.
+ *
+ * @param q A pointer to the queue.
+ * @param value The value to add to the queue, allocated with malloc.
+ * @return true if the value was added, false on failure, in which case the
+ * caller keeps ownership of value.
+ */
+bool queue_enqueue_owned(Queue *q, char *value);
+
 /**
  * @brief Removes and returns the value at the head of the queue.
  *
  * Removes the value from the front of the queue and returns it. The caller
- * is responsible for deallocating the returned string.
+ * is responsible for deallocating the returned string. It calls
+ * queue_dequeue_owned.
  *
  * @param q A pointer to the queue.
- * @return A pointer to the value removed from the queue.
+ * @return A pointer to the value removed from the queue, or NULL if the
+ * queue is empty.
  */
 char *queue_dequeue(Queue *q);
 
+/**
+ * @brief Removes the value at the head of the queue and hands it over.
+ *
+ * A value added with queue_enqueue_owned is handed back in its own
+ * buffer, and a copied value in its node, so no string is allocated or
+ * copied unless the queue is pooled (see list_take). The caller is
+ * responsible for deallocating the returned string.
+ *
+ * @param q A pointer to the queue.
+ * @return A pointer to the value removed from the queue, or NULL if the
+ * queue is empty.
+ */
+char *queue_dequeue_owned(Queue *q);
+
+/**
+ * @brief Returns the value at the head of the queue without removing it.
+ *
+ * @param q A pointer to the queue.
+ * @return A borrowed pointer to the value, valid until the value is
+ * dequeued, or NULL if the queue is empty.
+ */
+const char *queue_peek(const Queue *q);
+
 /**
  * @brief Checks if the queue is empty.
  *
@@ -21,8 +21,12 @@ void test_set_insert_and_member_of();
 void test_set_union();
 void test_set_intersection();
 void test_set_difference();
+void test_set_intersection_size();
+void test_set_reserve();
+void test_set_merge();
 void test_set_remove();
 void test_set_properties();
+void test_set_next();
 
 
 int main() 
@@ -34,8 +38,12 @@ int main()
     test_set_union();
     test_set_intersection();
     test_set_difference();
+    test_set_intersection_size();
+    test_set_reserve();
+    test_set_merge();
     test_set_remove();
     test_set_properties();
+    test_set_next();
     
     printf("All tests completed.\n");
     return 0;
@@ -121,6 +129,55 @@ void test_set_difference()
     set_destroy(d);
 }
 
+void test_set_intersection_size() 
+{
+    set *s1 = set_empty();
+    set *s2 = set_empty();
+    for (int i = 0; i < 200; i += 2) {
+        set_insert(i, s1);
+    }
+    for (int i = 0; i < 300; i += 3) {
+        set_insert(i, s2);
+    }
+
+    // Multiples of 6 below 200
+    int condition = set_intersection_size(s1, s2) == 34;
+    print_test_result(condition, "set_intersection_size");
+
+    set_destroy(s1);
+    set_destroy(s2);
+}
+
+void test_set_reserve() 
+{
+    set *s = set_single(3);
+    set_reserve(1000, s);
+    set_insert(999, s);
+
+    int condition = set_member_of(3, s) && set_member_of(999, s)
+                    && !set_member_of(500, s) && set_size(s) == 2;
+    print_test_result(condition, "set_reserve");
+
+    set_destroy(s);
+}
+
+void test_set_merge() 
+{
+    set *s1 = set_single(1);
+    set_insert(70, s1);
+    set *s2 = set_single(70);
+    set_insert(130, s2);
+    set_merge(s1, s2);
+
+    int condition = set_member_of(1, s1) && set_member_of(70, s1)
+                    && set_member_of(130, s1) && set_size(s1) == 3
+                    && set_size(s2) == 2;
+    print_test_result(condition, "set_merge");
+
+    set_destroy(s1);
+    set_destroy(s2);
+}
+
 void test_set_remove() 
 {
     set *s = set_single(1);
@@ -145,3 +202,26 @@ void test_set_properties()
     set_destroy(s2);
 }
 
+
+void test_set_next() 
+{
+    // Members far apart, so that whole empty words are skipped
+    int members[] = {0, 7, 8, 63, 64, 200, 1000};
+    set *s = set_empty();
+    set_reserve(1100, s);
+    for (int i = 0; i < 7; i++) {
+        set_insert(members[i], s);
+    }
+
+    int condition = 1;
+    int i = 0;
+    for (int v = set_next(0, s); v != -1; v = set_next(v + 1, s)) {
+        condition = condition && i < 7 && v == members[i];
+        i++;
+    }
+    condition = condition && i == 7 && set_next(-5, s) == 0 && set_next(9, s) == 63
+        && set_next(201, s) == 1000 && set_next(1001, s) == -1 && set_next(100000, s) == -1;
+    print_test_result(condition, "set_next");
+
+    set_destroy(s);
+}
@@ -11,6 +11,8 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include <stdio.h>
 #include "set.h"
@@ -21,6 +23,26 @@ struct set {
     char *array;
 };
 
+/* ---------------------- Internal functions ---------------------- */
+
+/**
+ * Counts the number of set bits in a 64-bit word.
+ */
+static int popcount64(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    while (word != 0) {
+        word &= word - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+/* ---------------------- External functions ---------------------- */
 
 
 set *set_empty() 
@@ -80,6 +102,26 @@ void set_insert(const int value, set *s)
     }
 }
 
+void set_reserve(const int capacity, set *s)
+{
+    if (s == NULL) {
+        perror("Error in set_reserve: Null set pointer");
+        return;
+    }
+
+    if (capacity > s->capacity) {
+        int no_of_bytes = (capacity + 7) / 8;
+        char *array = realloc(s->array, no_of_bytes);
+        if (array == NULL) {
+            perror("Error in set_reserve: Allocation failed");
+            return;
+        }
+        memset(array + s->capacity / 8, 0, no_of_bytes - s->capacity / 8);
+        s->array = array;
+        s->capacity = no_of_bytes * 8;
+    }
+}
+
 set *set_union(const set *const s1, const set *const s2) 
 {
     if (s1 == NULL || s2 == NULL) {
@@ -97,6 +139,49 @@ set *set_union(const set *const s1, const set *const s2)
     return s;
 }
 
+void set_merge(set *const s1, const set *const s2)
+{
+    if (s1 == NULL || s2 == NULL) {
+        perror("Error in set_merge: Null set pointer");
+        return;
+    }
+
+    // Only the part of s2 that holds members needs to fit in s1
+    int no_of_bytes = s2->capacity / 8;
+    while (no_of_bytes > 0 && s2->array[no_of_bytes - 1] == 0) {
+        no_of_bytes--;
+    }
+    set_reserve(no_of_bytes * 8, s1);
+    if (s1->capacity < no_of_bytes * 8) {
+        return;
+    }
+
+    int size = 0;
+    int i = 0;
+    for (; i + 8 <= no_of_bytes; i += 8) {
+        uint64_t w1, w2;
+        memcpy(&w1, s1->array + i, sizeof(w1));
+        memcpy(&w2, s2->array + i, sizeof(w2));
+        w1 |= w2;
+        memcpy(s1->array + i, &w1, sizeof(w1));
+    }
+    for (; i < no_of_bytes; i++) {
+        s1->array[i] |= s2->array[i];
+    }
+
+    // Recount the members, as the overlap of the two sets is unknown
+    int s1_bytes = s1->capacity / 8;
+    for (i = 0; i + 8 <= s1_bytes; i += 8) {
+        uint64_t w;
+        memcpy(&w, s1->array + i, sizeof(w));
+        size += popcount64(w);
+    }
+    for (; i < s1_bytes; i++) {
+        size += popcount64((unsigned char)s1->array[i]);
+    }
+    s1->size = size;
+}
+
 set *set_intersection(const set *const s1, const set *const s2) 
 {
     if (s1 == NULL || s2 == NULL) {
@@ -139,6 +224,30 @@ set *set_difference(const set *const s1, const set *const s2)
     return s;
 }
 
+int set_intersection_size(const set *const s1, const set *const s2)
+{
+    if (s1 == NULL || s2 == NULL) {
+        perror("Error in set_intersection_size: Null set pointer");
+        return 0;
+    }
+
+    int no_of_bytes = (s1->capacity < s2->capacity ? s1->capacity : s2->capacity) / 8;
+    int count = 0;
+    int i = 0;
+
+    for (; i + 8 <= no_of_bytes; i += 8) {
+        uint64_t w1, w2;
+        memcpy(&w1, s1->array + i, sizeof(w1));
+        memcpy(&w2, s2->array + i, sizeof(w2));
+        count += popcount64(w1 & w2);
+    }
+    for (; i < no_of_bytes; i++) {
+        count += popcount64((unsigned char)(s1->array[i] & s2->array[i]));
+    }
+
+    return count;
+}
+
 bool set_is_empty(const set *const s) 
 {
     if (s == NULL) {
@@ -230,6 +339,52 @@ bool set_subset(const set *const s1, const set *const s2)
     return true;
 }
 
+int set_next(const int value, const set *const s)
+{
+    if (s == NULL) {
+        perror("Error in set_next: Null set pointer");
+        return -1;
+    }
+
+    int from = value < 0 ? 0 : value;
+    if (from >= s->capacity) {
+        return -1;
+    }
+
+    int no_of_bytes = s->capacity / 8;
+    int byte_no = from / 8;
+
+    // Mask away the members smaller than from in the first byte
+    unsigned char the_byte = (unsigned char)s->array[byte_no] & (0xFF >> (from % 8));
+
+    while (the_byte == 0) {
+        byte_no++;
+
+        // Skip whole words of empty bytes
+        while (byte_no + 8 <= no_of_bytes) {
+            uint64_t word;
+            memcpy(&word, s->array + byte_no, sizeof(word));
+            if (word != 0) {
+                break;
+            }
+            byte_no += 8;
+        }
+
+        if (byte_no >= no_of_bytes) {
+            return -1;
+        }
+        the_byte = (unsigned char)s->array[byte_no];
+    }
+
+    // The most significant bit holds the smallest value in a byte
+    int bit = 0;
+    while (!(the_byte & (0x80 >> bit))) {
+        bit++;
+    }
+
+    return byte_no * 8 + bit;
+}
+
 int set_size(const set *const s) 
 {
     if (s == NULL) {
@@ -47,6 +47,18 @@ set *set_single(const int value);
  */
 void set_insert(const int value, set *s);
 
+/**
+ * @brief Makes room for all values below a given capacity.
+ *
+ * Inserting many values into a set grows its bitmap one step at a time.
+ * Reserving the final capacity first makes the following inserts free of
+ * reallocations. The set never shrinks.
+ *
+ * @param capacity The number of values to make room for.
+ * @param s The set to grow.
+ */
+void set_reserve(const int capacity, set *s);
+
 /**
  * @brief Returns a new set that is the union of two sets.
  * 
@@ -56,6 +68,17 @@ void set_insert(const int value, set *s);
  */
 set *set_union(const set *const s1, const set *const s2);
 
+/**
+ * @brief Adds all members of the second set to the first set.
+ *
+ * Unlike set_union, no new set is created. The bitmaps are combined a
+ * machine word at a time with a bitwise or.
+ *
+ * @param s1 The set to add members to.
+ * @param s2 The set whose members are added.
+ */
+void set_merge(set *const s1, const set *const s2);
+
 /**
  * @brief Returns a new set that is the intersection of two sets.
  * 
@@ -74,6 +97,18 @@ set *set_intersection(const set *const s1, const set *const s2);
  */
 set *set_difference(const set *const s1, const set *const s2);
 
+/**
+ * @brief Returns the number of elements in the intersection of two sets.
+ *
+ * The sets are combined a machine word at a time with a bitwise and and a
+ * population count, so no intermediate set is created.
+ *
+ * @param s1 The first set.
+ * @param s2 The second set.
+ * @return The number of values that are members of both s1 and s2.
+ */
+int set_intersection_size(const set *const s1, const set *const s2);
+
 /**
  * @brief Checks if the set is empty.
  * 
@@ -133,6 +168,20 @@ bool set_subset(const set *const s1, const set *const s2);
  */
 int *set_get_values(const set *const s);
 
+/**
+ * @brief Returns the smallest member of the set that is greater than or
+ * equal to a given value.
+ *
+ * Empty parts of the set are skipped a machine word at a time, so iterating
+ * over all members with this function is much cheaper than calling
+ * set_member_of for every possible value.
+ *
+ * @param value The value to start searching from.
+ * @param s The set to search in.
+ * @return The next member, or -1 if there is no member >= value.
+ */
+int set_next(const int value, const set *const s);
+
 /**
  * @brief Returns the number of elements in the set.
  * 